@@ -448,6 +448,13 @@ lSetInternalFunctions(llvm::Module *module) {
         "__count_trailing_zeros_i64",
         "__count_leading_zeros_i32",
         "__count_leading_zeros_i64",
+        "__count_trailing_zeros_varying_i32",
+        "__count_trailing_zeros_varying_i64",
+        "__count_leading_zeros_varying_i32",
+        "__count_leading_zeros_varying_i64",
+        "__crc32c_u8",
+        "__crc32c_u32",
+        "__crc32c_u64",
         "__delete_uniform_32rt",
         "__delete_uniform_64rt",
         "__delete_varying_32rt",
@@ -549,6 +556,10 @@ lSetInternalFunctions(llvm::Module *module) {
         "__padds_vi16",
         "__paddus_vi8",
         "__paddus_vi16",
+        "__pdep_u32",
+        "__pdep_u64",
+        "__pext_u32",
+        "__pext_u64",
         "__popcnt_int32",
         "__popcnt_int64",
         "__prefetch_read_uniform_1",
@@ -1445,6 +1456,12 @@ DefineStdlib(SymbolTable *symbolTable, llvm::LLVMContext *ctx, llvm::Module *mod
                        module, symbolTable);
     lDefineConstantInt("__have_native_rcpd", g->target->hasRcpd(),
                        module, symbolTable);
+    lDefineConstantInt("__have_native_vector_count_zeros",
+                       g->target->hasVecCountZeros(), module, symbolTable);
+    lDefineConstantInt("__have_native_crc32c", g->target->hasCrc32c(),
+                       module, symbolTable);
+    lDefineConstantInt("__have_native_pdep_pext", g->target->hasPdepPext(),
+                       module, symbolTable);
 
 #ifdef ISPC_NVPTX_ENABLED
     lDefineConstantInt("__is_nvptx_target", (int)(g->target->getISA() == Target::NVPTX),
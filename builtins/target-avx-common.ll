@@ -40,6 +40,7 @@ ctlztz()
 define_prefetches()
 define_shuffles()
 aossoa()
+crc32c_definition()
 
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
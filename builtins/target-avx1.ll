@@ -32,6 +32,7 @@
 include(`target-avx.ll')
 
 rdrand_decls()
+pdep_pext_decls()
 saturation_arithmetic()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
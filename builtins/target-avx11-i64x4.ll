@@ -32,6 +32,7 @@
 include(`target-avx1-i64x4base.ll')
 
 rdrand_definition()
+pdep_pext_decls()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; int min/max
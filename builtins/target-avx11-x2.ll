@@ -32,6 +32,7 @@
 include(`target-avx-x2.ll')
 
 rdrand_definition()
+pdep_pext_decls()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; int min/max
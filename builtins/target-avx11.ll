@@ -32,6 +32,7 @@
 include(`target-avx.ll')
 
 rdrand_definition()
+pdep_pext_decls()
 saturation_arithmetic()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
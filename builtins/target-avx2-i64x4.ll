@@ -34,6 +34,7 @@ define(`HAVE_GATHER', `1')
 include(`target-avx1-i64x4base.ll')
 
 rdrand_definition()
+pdep_pext_definition()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; int min/max
@@ -34,6 +34,7 @@ define(`HAVE_GATHER', `1')
 include(`target-avx.ll')
 
 rdrand_definition()
+pdep_pext_definition()
 saturation_arithmetic()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
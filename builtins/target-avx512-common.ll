@@ -39,6 +39,8 @@ stdlib_core()
 scans()
 reduce_equal(WIDTH)
 rdrand_definition()
+pdep_pext_definition()
+crc32c_definition()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; broadcast/rotate/shuffle
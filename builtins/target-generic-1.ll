@@ -36,6 +36,8 @@ define(`MASK',`i32')
 define(`WIDTH',`1')
 include(`util.m4')
 rdrand_decls()
+pdep_pext_decls()
+crc32c_decls()
 ; Define some basics for a 1-wide target
 stdlib_core()
 packed_load_and_store()
@@ -39,6 +39,8 @@ stdlib_core()
 scans()
 reduce_equal(WIDTH)
 rdrand_decls()
+pdep_pext_decls()
+crc32c_decls()
 define_shuffles()
 aossoa()
 ctlztz()
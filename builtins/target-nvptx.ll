@@ -402,6 +402,8 @@ stdlib_core()
 packed_load_and_store()
 int64minmax()
 rdrand_decls()
+pdep_pext_decls()
+crc32c_decls()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; broadcast/rotate/shuffle
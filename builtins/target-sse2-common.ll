@@ -34,6 +34,8 @@ define_prefetches()
 define_shuffles()
 aossoa()
 rdrand_decls()
+pdep_pext_decls()
+crc32c_decls()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; rcp
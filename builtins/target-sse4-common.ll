@@ -37,6 +37,8 @@ define_prefetches()
 define_shuffles()
 aossoa()
 rdrand_decls()
+pdep_pext_decls()
+crc32c_definition()
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; rounding floats
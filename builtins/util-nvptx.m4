@@ -891,6 +891,35 @@ define i64 @__count_leading_zeros_i64(i64) nounwind readnone alwaysinline {
   %c = call i64 @llvm.ctlz.i64(i64 %0)
   ret i64 %c
 }
+
+;; Per-lane counts, used by the varying count_leading_zeros() and
+;; count_trailing_zeros() in the standard library on targets that have
+;; vector instructions for them (see Target::hasVecCountZeros()).
+
+declare <WIDTH x i32> @llvm.ctlz.v`'WIDTH`'i32(<WIDTH x i32>, i1) nounwind readnone
+declare <WIDTH x i64> @llvm.ctlz.v`'WIDTH`'i64(<WIDTH x i64>, i1) nounwind readnone
+declare <WIDTH x i32> @llvm.cttz.v`'WIDTH`'i32(<WIDTH x i32>, i1) nounwind readnone
+declare <WIDTH x i64> @llvm.cttz.v`'WIDTH`'i64(<WIDTH x i64>, i1) nounwind readnone
+
+define <WIDTH x i32> @__count_trailing_zeros_varying_i32(<WIDTH x i32>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i32> @llvm.cttz.v`'WIDTH`'i32(<WIDTH x i32> %0, i1 false)
+  ret <WIDTH x i32> %c
+}
+
+define <WIDTH x i64> @__count_trailing_zeros_varying_i64(<WIDTH x i64>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i64> @llvm.cttz.v`'WIDTH`'i64(<WIDTH x i64> %0, i1 false)
+  ret <WIDTH x i64> %c
+}
+
+define <WIDTH x i32> @__count_leading_zeros_varying_i32(<WIDTH x i32>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i32> @llvm.ctlz.v`'WIDTH`'i32(<WIDTH x i32> %0, i1 false)
+  ret <WIDTH x i32> %c
+}
+
+define <WIDTH x i64> @__count_leading_zeros_varying_i64(<WIDTH x i64>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i64> @llvm.ctlz.v`'WIDTH`'i64(<WIDTH x i64> %0, i1 false)
+  ret <WIDTH x i64> %c
+}
 ')
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -3314,6 +3343,25 @@ define i1 @__rdrand_i64(i64 * %ptr) {
 }
 ')
 
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; crc32c
+
+define(`crc32c_decls', `
+declare i32 @__crc32c_u8(i32, i8) nounwind readnone
+declare i32 @__crc32c_u32(i32, i32) nounwind readnone
+declare i32 @__crc32c_u64(i32, i64) nounwind readnone
+')
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; pdep/pext
+
+define(`pdep_pext_decls', `
+declare i32 @__pdep_u32(i32, i32) nounwind readnone
+declare i64 @__pdep_u64(i64, i64) nounwind readnone
+declare i32 @__pext_u32(i32, i32) nounwind readnone
+declare i64 @__pext_u64(i64, i64) nounwind readnone
+')
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; int8/int16 builtins
 
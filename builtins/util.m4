@@ -1609,6 +1609,35 @@ define i64 @__count_leading_zeros_i64(i64) nounwind readnone alwaysinline {
   %c = call i64 @llvm.ctlz.i64(i64 %0)
   ret i64 %c
 }
+
+;; Per-lane counts, used by the varying count_leading_zeros() and
+;; count_trailing_zeros() in the standard library on targets that have
+;; vector instructions for them (see Target::hasVecCountZeros()).
+
+declare <WIDTH x i32> @llvm.ctlz.v`'WIDTH`'i32(<WIDTH x i32>, i1) nounwind readnone
+declare <WIDTH x i64> @llvm.ctlz.v`'WIDTH`'i64(<WIDTH x i64>, i1) nounwind readnone
+declare <WIDTH x i32> @llvm.cttz.v`'WIDTH`'i32(<WIDTH x i32>, i1) nounwind readnone
+declare <WIDTH x i64> @llvm.cttz.v`'WIDTH`'i64(<WIDTH x i64>, i1) nounwind readnone
+
+define <WIDTH x i32> @__count_trailing_zeros_varying_i32(<WIDTH x i32>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i32> @llvm.cttz.v`'WIDTH`'i32(<WIDTH x i32> %0, i1 false)
+  ret <WIDTH x i32> %c
+}
+
+define <WIDTH x i64> @__count_trailing_zeros_varying_i64(<WIDTH x i64>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i64> @llvm.cttz.v`'WIDTH`'i64(<WIDTH x i64> %0, i1 false)
+  ret <WIDTH x i64> %c
+}
+
+define <WIDTH x i32> @__count_leading_zeros_varying_i32(<WIDTH x i32>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i32> @llvm.ctlz.v`'WIDTH`'i32(<WIDTH x i32> %0, i1 false)
+  ret <WIDTH x i32> %c
+}
+
+define <WIDTH x i64> @__count_leading_zeros_varying_i64(<WIDTH x i64>) nounwind readnone alwaysinline {
+  %c = call <WIDTH x i64> @llvm.ctlz.v`'WIDTH`'i64(<WIDTH x i64> %0, i1 false)
+  ret <WIDTH x i64> %c
+}
 ')
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -4901,6 +4930,134 @@ define i1 @__rdrand_i64(i64 * %ptr) {
 }
 ')
 
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; crc32c
+
+define(`crc32c_decls', `
+declare i32 @__crc32c_u8(i32, i8) nounwind readnone
+declare i32 @__crc32c_u32(i32, i32) nounwind readnone
+declare i32 @__crc32c_u64(i32, i64) nounwind readnone
+')
+
+;; The SSE4.2 crc32 instruction, without the initial and final inversions
+;; of the CRC; on 32-bit targets the 64-bit form is done as two 32-bit
+;; steps.
+
+define(`crc32c_definition', `
+declare i32 @llvm.x86.sse42.crc32.32.8(i32, i8) nounwind readnone
+declare i32 @llvm.x86.sse42.crc32.32.32(i32, i32) nounwind readnone
+
+define i32 @__crc32c_u8(i32 %crc, i8 %v) nounwind readnone alwaysinline {
+  %r = call i32 @llvm.x86.sse42.crc32.32.8(i32 %crc, i8 %v)
+  ret i32 %r
+}
+
+define i32 @__crc32c_u32(i32 %crc, i32 %v) nounwind readnone alwaysinline {
+  %r = call i32 @llvm.x86.sse42.crc32.32.32(i32 %crc, i32 %v)
+  ret i32 %r
+}
+
+ifelse(RUNTIME, `64', `
+declare i64 @llvm.x86.sse42.crc32.64.64(i64, i64) nounwind readnone
+
+define i32 @__crc32c_u64(i32 %crc, i64 %v) nounwind readnone alwaysinline {
+  %crc64 = zext i32 %crc to i64
+  %r64 = call i64 @llvm.x86.sse42.crc32.64.64(i64 %crc64, i64 %v)
+  %r = trunc i64 %r64 to i32
+  ret i32 %r
+}
+', `
+define i32 @__crc32c_u64(i32 %crc, i64 %v) nounwind readnone alwaysinline {
+  %lo = trunc i64 %v to i32
+  %hi64 = lshr i64 %v, 32
+  %hi = trunc i64 %hi64 to i32
+  %r0 = call i32 @llvm.x86.sse42.crc32.32.32(i32 %crc, i32 %lo)
+  %r = call i32 @llvm.x86.sse42.crc32.32.32(i32 %r0, i32 %hi)
+  ret i32 %r
+}
+')
+')
+
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; pdep/pext
+
+define(`pdep_pext_decls', `
+declare i32 @__pdep_u32(i32, i32) nounwind readnone
+declare i64 @__pdep_u64(i64, i64) nounwind readnone
+declare i32 @__pext_u32(i32, i32) nounwind readnone
+declare i64 @__pext_u64(i64, i64) nounwind readnone
+')
+
+;; The BMI2 pdep and pext instructions; on 32-bit targets the 64-bit forms
+;; are done on the two 32-bit halves, where the high half of the mask takes
+;; the bits after the ones that the low half takes.
+
+define(`pdep_pext_definition', `
+declare i32 @llvm.x86.bmi.pdep.32(i32, i32) nounwind readnone
+declare i32 @llvm.x86.bmi.pext.32(i32, i32) nounwind readnone
+
+define i32 @__pdep_u32(i32 %v, i32 %mask) nounwind readnone alwaysinline {
+  %r = call i32 @llvm.x86.bmi.pdep.32(i32 %v, i32 %mask)
+  ret i32 %r
+}
+
+define i32 @__pext_u32(i32 %v, i32 %mask) nounwind readnone alwaysinline {
+  %r = call i32 @llvm.x86.bmi.pext.32(i32 %v, i32 %mask)
+  ret i32 %r
+}
+
+ifelse(RUNTIME, `64', `
+declare i64 @llvm.x86.bmi.pdep.64(i64, i64) nounwind readnone
+declare i64 @llvm.x86.bmi.pext.64(i64, i64) nounwind readnone
+
+define i64 @__pdep_u64(i64 %v, i64 %mask) nounwind readnone alwaysinline {
+  %r = call i64 @llvm.x86.bmi.pdep.64(i64 %v, i64 %mask)
+  ret i64 %r
+}
+
+define i64 @__pext_u64(i64 %v, i64 %mask) nounwind readnone alwaysinline {
+  %r = call i64 @llvm.x86.bmi.pext.64(i64 %v, i64 %mask)
+  ret i64 %r
+}
+', `
+define i64 @__pdep_u64(i64 %v, i64 %mask) nounwind readnone alwaysinline {
+  %m_lo = trunc i64 %mask to i32
+  %m_hi64 = lshr i64 %mask, 32
+  %m_hi = trunc i64 %m_hi64 to i32
+  %n_lo = call i32 @__popcnt_int32(i32 %m_lo)
+  %n_lo64 = zext i32 %n_lo to i64
+  %v_lo = trunc i64 %v to i32
+  %v_hi64 = lshr i64 %v, %n_lo64
+  %v_hi = trunc i64 %v_hi64 to i32
+  %r_lo = call i32 @llvm.x86.bmi.pdep.32(i32 %v_lo, i32 %m_lo)
+  %r_hi = call i32 @llvm.x86.bmi.pdep.32(i32 %v_hi, i32 %m_hi)
+  %r_lo64 = zext i32 %r_lo to i64
+  %r_hi64 = zext i32 %r_hi to i64
+  %r_hi64s = shl i64 %r_hi64, 32
+  %r = or i64 %r_lo64, %r_hi64s
+  ret i64 %r
+}
+
+define i64 @__pext_u64(i64 %v, i64 %mask) nounwind readnone alwaysinline {
+  %m_lo = trunc i64 %mask to i32
+  %m_hi64 = lshr i64 %mask, 32
+  %m_hi = trunc i64 %m_hi64 to i32
+  %n_lo = call i32 @__popcnt_int32(i32 %m_lo)
+  %n_lo64 = zext i32 %n_lo to i64
+  %v_lo = trunc i64 %v to i32
+  %v_hi64 = lshr i64 %v, 32
+  %v_hi = trunc i64 %v_hi64 to i32
+  %r_lo = call i32 @llvm.x86.bmi.pext.32(i32 %v_lo, i32 %m_lo)
+  %r_hi = call i32 @llvm.x86.bmi.pext.32(i32 %v_hi, i32 %m_hi)
+  %r_lo64 = zext i32 %r_lo to i64
+  %r_hi64 = zext i32 %r_hi to i64
+  %r_hi64s = shl i64 %r_hi64, %n_lo64
+  %r = or i64 %r_lo64, %r_hi64s
+  ret i64 %r
+}
+')
+')
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; int8/int16 builtins
 
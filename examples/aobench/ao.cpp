@@ -48,6 +48,7 @@
 #include <math.h>
 #include <map>
 #include <string>
+#include <vector>
 #include <algorithm>
 #include <sys/types.h>
 
@@ -58,6 +59,15 @@ using namespace ispc;
 
 #define NSUBSAMPLES        2
 
+// Progressive rendering: passes of PROGRESSIVE_SPP samples per pixel over
+// tiles of PROGRESSIVE_TILE x PROGRESSIVE_TILE pixels, until the RMS
+// standard error of the pixels of a tile is below PROGRESSIVE_ERROR (or
+// after PROGRESSIVE_MAX_PASSES passes).
+#define PROGRESSIVE_TILE       16
+#define PROGRESSIVE_SPP        4
+#define PROGRESSIVE_ERROR      0.01f
+#define PROGRESSIVE_MAX_PASSES 64
+
 extern void ao_serial(int w, int h, int nsubsamples, float image[]);
 
 static unsigned int test_iterations[] = {3, 7, 1};
@@ -168,6 +178,66 @@ int main(int argc, char **argv)
            minTimeISPCTasks, width, height);
     savePPM("ao-ispc-tasks.ppm", width, height); 
 
+    //
+    // Run the progressive path: each pass only renders the tiles that
+    // haven't converged yet.
+    //
+    int nTilesX = (width + PROGRESSIVE_TILE - 1) / PROGRESSIVE_TILE;
+    int nTilesY = (height + PROGRESSIVE_TILE - 1) / PROGRESSIVE_TILE;
+    int nTiles = nTilesX * nTilesY;
+    std::vector<int> active, tileSamples(nTiles, 0);
+    std::vector<float> sum(width * height, 0.f), sumSq(width * height, 0.f);
+    std::vector<float> tileError(nTiles, 0.f);
+    for (int i = 0; i < nTiles; i++)
+        active.push_back(i);
+
+    // The time and number of tiles of each pass are only printed after the
+    // run, so that the output doesn't add to the total time.
+    std::vector<double> passTimes;
+    std::vector<int> passTiles;
+    reset_and_start_timer();
+    int pass;
+    for (pass = 0; pass < PROGRESSIVE_MAX_PASSES && !active.empty(); pass++) {
+        ao_progressive_pass(width, height, PROGRESSIVE_TILE, &active[0],
+                            (int)active.size(), PROGRESSIVE_SPP, &tileSamples[0],
+                            &sum[0], &sumSq[0], &tileError[0]);
+
+        // The variance estimate needs a couple of passes to be meaningful.
+        std::vector<int> stillActive;
+        for (size_t i = 0; i < active.size(); i++)
+            if (pass < 1 || tileError[active[i]] > PROGRESSIVE_ERROR)
+                stillActive.push_back(active[i]);
+        passTimes.push_back(get_elapsed_mcycles());
+        passTiles.push_back((int)active.size());
+        active.swap(stillActive);
+    }
+    double timeProgressive = get_elapsed_mcycles();
+    for (size_t i = 0; i < passTimes.size(); i++)
+        printf("@pass %d of ISPC + TASKS progressive run:\t[%.3f] million cycles "
+               "(%d of %d tiles rendered)\n", (int)i, passTimes[i],
+               passTiles[i], nTiles);
+
+    double totalSamples = 0;
+    int maxSamples = 0;
+    for (int t = 0; t < nTiles; t++) {
+        int x0 = (t % nTilesX) * PROGRESSIVE_TILE, y0 = (t / nTilesX) * PROGRESSIVE_TILE;
+        int x1 = std::min(x0 + PROGRESSIVE_TILE, (int)width);
+        int y1 = std::min(y0 + PROGRESSIVE_TILE, (int)height);
+        for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++)
+                for (int c = 0; c < 3; c++)
+                    fimg[3 * (y * width + x) + c] = sum[y * width + x] / tileSamples[t];
+        totalSamples += (double)tileSamples[t] * (x1 - x0) * (y1 - y0);
+        maxSamples = std::max(maxSamples, tileSamples[t]);
+    }
+
+    printf("[aobench ispc + tasks, progressive]:\t[%.3f] million cycles to reach "
+           "error %g%s (%d passes)\n", timeProgressive, PROGRESSIVE_ERROR,
+           active.empty() ? "" : " in some tiles only", pass);
+    printf("\t\t\t\t(%.1f samples/pixel on average, %d in the worst tiles)\n",
+           totalSamples / (width * height), maxSamples);
+    savePPM("ao-ispc-progressive.ppm", width, height);
+
     //
     // Run the serial path, again test_iteration times, and report the
     // minimum time.
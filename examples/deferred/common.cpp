@@ -60,6 +60,7 @@
 #endif
 #include "deferred.h"
 #include "../timing.h"
+#include "../mapped_file.h"
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -119,27 +120,8 @@ Framebuffer::clear() {
 }
 
 
-InputData *
-CreateInputDataFromFile(const char *path) {
-    FILE *in = fopen(path, "rb");
-    if (!in) return 0;
-
-    InputData *input = new InputData;
-
-    // Load header
-    if (fread(&input->header, sizeof(ispc::InputHeader), 1, in) != 1) {
-        fprintf(stderr, "Preumature EOF reading file \"%s\"\n", path);
-        return NULL;
-    }
-
-    // Load data chunk and update pointers
-    input->chunk = (uint8_t *)lAlignedMalloc(input->header.inputDataChunkSize, 
-                                             ALIGNMENT_BYTES);
-    if (fread(input->chunk, input->header.inputDataChunkSize, 1, in) != 1) {
-        fprintf(stderr, "Preumature EOF reading file \"%s\"\n", path);
-        return NULL;
-    }
-    
+static void
+lSetArrayPointers(InputData *input) {
     input->arrays.zBuffer =
         (float *)&input->chunk[input->header.inputDataArrayOffsets[idaZBuffer]];
     input->arrays.normalEncoded_x =
@@ -172,14 +154,94 @@ CreateInputDataFromFile(const char *path) {
         (float *)&input->chunk[input->header.inputDataArrayOffsets[idaLightColor_z]];
     input->arrays.lightAttenuationEnd =
         (float *)&input->chunk[input->header.inputDataArrayOffsets[idaLightAttenuationEnd]];
+}
+
+
+// Reads the original input format: an InputHeader directly followed by
+// the data chunk.
+static InputData *
+lReadInputDataFile(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (!in) return 0;
+
+    InputData *input = new InputData;
+    input->mapping = NULL;
+
+    // Load header
+    if (fread(&input->header, sizeof(ispc::InputHeader), 1, in) != 1) {
+        fprintf(stderr, "Preumature EOF reading file \"%s\"\n", path);
+        return NULL;
+    }
+
+    // Load data chunk and update pointers
+    input->chunk = (uint8_t *)lAlignedMalloc(input->header.inputDataChunkSize, 
+                                             ALIGNMENT_BYTES);
+    if (fread(input->chunk, input->header.inputDataChunkSize, 1, in) != 1) {
+        fprintf(stderr, "Preumature EOF reading file \"%s\"\n", path);
+        return NULL;
+    }
+    
+    lSetArrayPointers(input);
 
     fclose(in);
     return input;
 }
 
 
+
+// Loads the input from the aligned mapped version of the file
+// (<path>.mmap), which holds the InputHeader in its first section and the
+// data chunk in its second one, so that the kernels read the data in
+// place.  The mapped file is created from the original one the first time
+// around, and again whenever the original one changes.
+InputData *
+CreateInputDataFromFile(const char *path) {
+    const char magic[8] = "ISPCDEF";
+    char mappedPath[1024];
+    snprintf(mappedPath, sizeof(mappedPath), "%s.mmap", path);
+
+    reset_and_start_timer();
+    MappedFile *mapping = new MappedFile;
+    if (!mapping->open(mappedPath, magic, 1, path)) {
+        InputData *input = lReadInputDataFile(path);
+        if (!input) {
+            delete mapping;
+            return NULL;
+        }
+        double readTime = get_elapsed_mcycles();
+
+        const void *data[2] = { &input->header, input->chunk };
+        uint64_t size[2] = { sizeof(ispc::InputHeader),
+                             (uint64_t)input->header.inputDataChunkSize };
+        if (writeMappedFile(mappedPath, magic, 1, 2, data, size, path))
+            printf("Converted %s to %s (reading it took %.3f million cycles)\n",
+                   path, mappedPath, readTime);
+        reset_and_start_timer();
+        if (!mapping->open(mappedPath, magic, 1, path)) {
+            delete mapping;
+            printf("Loaded %s in %.3f million cycles\n", path, readTime);
+            return input;
+        }
+        DeleteInputData(input);
+        delete input;
+    }
+
+    InputData *input = new InputData;
+    input->mapping = mapping;
+    memcpy(&input->header, mapping->section(0), sizeof(ispc::InputHeader));
+    input->chunk = (uint8_t *)mapping->section(1);
+    lSetArrayPointers(input);
+    printf("Mapped %s in %.3f million cycles, peak RSS %.1f MB\n", mappedPath,
+           get_elapsed_mcycles(), peakRSSMegabytes());
+    return input;
+}
+
+
 void DeleteInputData(InputData *input) {
-    lAlignedFree(input->chunk);
+    if (input->mapping)
+        delete input->mapping;
+    else
+        lAlignedFree(input->chunk);
 }
 
 
@@ -71,11 +71,15 @@ enum InputDataArraysEnum {
 
 #define VISUALIZE_LIGHT_COUNT 0
 
+class MappedFile;
+
 struct InputData
 {
     ispc::InputHeader header;
     ispc::InputDataArrays arrays;
     uint8_t *chunk;
+    // Non-NULL if chunk points into a memory-mapped input file
+    MappedFile *mapping;
 };
 
 
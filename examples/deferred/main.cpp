@@ -88,7 +88,7 @@ int main(int argc, char** argv) {
 #endif // __cilk
 
     int nframes = test_iterations[2];
-    double ispcCycles = 1e30;
+    double ispcCycles = 1e30, ispcMsec = 1e30;
     for (unsigned int i = 0; i < test_iterations[0]; ++i) {
         framebuffer.clear();
         reset_and_start_timer();
@@ -96,15 +96,51 @@ int main(int argc, char** argv) {
             ispc::RenderStatic(input->header, input->arrays,
                                VISUALIZE_LIGHT_COUNT,
                                framebuffer.r, framebuffer.g, framebuffer.b);
-        double mcycles = get_elapsed_mcycles() / nframes;
+        double mcycles = get_elapsed_mcycles();
+        double msec = get_elapsed_sec() * 1e3 / nframes;
+        mcycles /= nframes;
         printf("@time of ISPC + TASKS run:\t\t\t[%.3f] million cycles\n", mcycles);
         ispcCycles = std::min(ispcCycles, mcycles);
+        ispcMsec = std::min(ispcMsec, msec);
     }
     printf("[ispc static + tasks]:\t\t[%.3f] million cycles to render "
-           "%d x %d image\n", ispcCycles,
-           input->header.framebufferWidth, input->header.framebufferHeight);
+           "%d x %d image (%.2f ms/frame)\n", ispcCycles,
+           input->header.framebufferWidth, input->header.framebufferHeight,
+           ispcMsec);
     WriteFrame("deferred-ispc-static.ppm", input, framebuffer);
 
+    // Keep the static result to compare the clustered one against it.
+    int nPixels = input->header.framebufferWidth * input->header.framebufferHeight;
+    std::vector<uint8_t> staticImage(framebuffer.r, framebuffer.r + nPixels);
+    staticImage.insert(staticImage.end(), framebuffer.g, framebuffer.g + nPixels);
+    staticImage.insert(staticImage.end(), framebuffer.b, framebuffer.b + nPixels);
+
+    double clusteredCycles = 1e30, clusteredMsec = 1e30;
+    for (unsigned int i = 0; i < test_iterations[0]; ++i) {
+        framebuffer.clear();
+        reset_and_start_timer();
+        for (int j = 0; j < nframes; ++j)
+            ispc::RenderClustered(input->header, input->arrays,
+                                  VISUALIZE_LIGHT_COUNT,
+                                  framebuffer.r, framebuffer.g, framebuffer.b);
+        double mcycles = get_elapsed_mcycles();
+        double msec = get_elapsed_sec() * 1e3 / nframes;
+        mcycles /= nframes;
+        printf("@time of ISPC clustered + TASKS run:\t\t[%.3f] million cycles\n", mcycles);
+        clusteredCycles = std::min(clusteredCycles, mcycles);
+        clusteredMsec = std::min(clusteredMsec, msec);
+    }
+    int maxDiff = 0;
+    const uint8_t *channels[3] = { framebuffer.r, framebuffer.g, framebuffer.b };
+    for (int c = 0; c < 3; ++c)
+        for (int i = 0; i < nPixels; ++i)
+            maxDiff = std::max(maxDiff, abs((int)channels[c][i] -
+                                            (int)staticImage[c * nPixels + i]));
+    printf("[ispc clustered + tasks]:\t[%.3f] million cycles to render "
+           "image (%.2f ms/frame, %.2fx vs. static, max difference %d)\n",
+           clusteredCycles, clusteredMsec, ispcCycles / clusteredCycles, maxDiff);
+    WriteFrame("deferred-ispc-clustered.ppm", input, framebuffer);
+
     nframes = 3;
 #ifdef __cilk
     double dynamicCilkCycles = 1e30;
@@ -122,25 +158,29 @@ int main(int argc, char** argv) {
     WriteFrame("deferred-ispc-dynamic.ppm", input, framebuffer);
 #endif // __cilk
 
-    double serialCycles = 1e30;
+    double serialCycles = 1e30, serialMsec = 1e30;
     for (unsigned int i = 0; i < test_iterations[1]; ++i) {
         framebuffer.clear();
         reset_and_start_timer();
         for (int j = 0; j < nframes; ++j)
             DispatchDynamicC(input, &framebuffer);
-        double mcycles = get_elapsed_mcycles() / nframes;
+        double mcycles = get_elapsed_mcycles();
+        double msec = get_elapsed_sec() * 1e3 / nframes;
+        mcycles /= nframes;
         printf("@time of serial run:\t\t\t[%.3f] million cycles\n", mcycles);
         serialCycles = std::min(serialCycles, mcycles);
+        serialMsec = std::min(serialMsec, msec);
     }
-    printf("[C++ serial dynamic, 1 core]:\t[%.3f] million cycles to render image\n", 
-           serialCycles);
+    printf("[C++ serial dynamic, 1 core]:\t[%.3f] million cycles to render image "
+           "(%.2f ms/frame)\n", serialCycles, serialMsec);
     WriteFrame("deferred-serial-dynamic.ppm", input, framebuffer);
 
 #ifdef __cilk
     printf("\t\t\t\t(%.2fx speedup from static ISPC, %.2fx from Cilk+ISPC)\n", 
            serialCycles/ispcCycles, serialCycles/dynamicCilkCycles);
 #else
-    printf("\t\t\t\t(%.2fx speedup from ISPC + tasks)\n", serialCycles/ispcCycles);
+    printf("\t\t\t\t(%.2fx speedup from ISPC + tasks, %.2fx from clustered ISPC + tasks)\n",
+           serialCycles/ispcCycles, serialCycles/clusteredCycles);
 #endif // __cilk
 
     DeleteInputData(input);
@@ -0,0 +1,417 @@
+/*
+  Copyright (c) 2010-2014, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+#pragma warning (disable: 4244)
+#pragma warning (disable: 4305)
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "../timing.h"
+#include "fft_ispc.h"
+using namespace ispc;
+
+
+extern void fft_serial_twiddles(int n, float tw[]);
+extern void fft_serial(int n, float re[], float im[], float wr[], float wi[],
+                       const float tw[]);
+
+static const double TWO_PI = 6.283185307179586;
+
+
+static float *
+makeTwiddles(int n) {
+    float *tw = new float[2 * std::max(1, fft_twiddle_count(n))];
+    fft_init_twiddles(n, tw);
+    return tw;
+}
+
+
+static void
+fillRandom(float *v, int count) {
+    for (int i = 0; i < count; ++i)
+        v[i] = float(rand()) / float(RAND_MAX) - 0.5f;
+}
+
+
+// O(n^2) DFT in double precision of the n values at (re, im), read and
+// written with the given stride.
+static void
+naiveDFT(int n, const float re[], const float im[], int stride,
+         double outRe[], double outIm[], bool inverse) {
+    for (int k = 0; k < n; ++k) {
+        double sr = 0, si = 0;
+        for (int j = 0; j < n; ++j) {
+            // Reduce j*k mod n first so that the angle stays small.
+            double angle = (inverse ? TWO_PI : -TWO_PI) *
+                double((long long)j * k % n) / n;
+            double c = cos(angle), s = sin(angle);
+            sr += re[j * stride] * c - im[j * stride] * s;
+            si += re[j * stride] * s + im[j * stride] * c;
+        }
+        outRe[k * stride] = sr;
+        outIm[k * stride] = si;
+    }
+}
+
+
+// Returns the RMS error of (re, im) relative to the RMS magnitude of the
+// reference (refRe, refIm).
+static double
+rmsError(int count, const float re[], const float im[], const double refRe[],
+         const double refIm[]) {
+    double err = 0, mag = 0;
+    for (int i = 0; i < count; ++i) {
+        double dr = re[i] - refRe[i], di = im[i] - refIm[i];
+        err += dr * dr + di * di;
+        mag += refRe[i] * refRe[i] + refIm[i] * refIm[i];
+    }
+    return (mag > 0) ? sqrt(err / mag) : sqrt(err);
+}
+
+
+// Float transforms of random data should be within a small multiple of
+// float epsilon of the exact result (the error grows as log n).
+static const double maxRmsError = 1e-5;
+
+static bool
+report(const char *what, int n, double err) {
+    if (err > maxRmsError) {
+        printf("Error: %s, n = %d: relative RMS error %g\n", what, n, err);
+        return false;
+    }
+    return true;
+}
+
+
+// Checks the split, interleaved and batched 1D transforms in both
+// directions against the naive DFT for n = 1 ... 4096, which covers both
+// odd and even numbers of radix-4 stages and sizes smaller than the gang.
+static bool
+check1D() {
+    bool ok = true;
+    double worst = 0;
+    for (int n = 1; n <= 4096; n *= 2) {
+        float *tw = makeTwiddles(n);
+        float *re = new float[n], *im = new float[n];
+        float *data = new float[2 * n], *work = new float[4 * n];
+        double *refRe = new double[n], *refIm = new double[n];
+        fillRandom(re, n);
+        fillRandom(im, n);
+
+        for (int inverse = 0; inverse < 2; ++inverse) {
+            naiveDFT(n, re, im, 1, refRe, refIm, inverse);
+
+            float *r = new float[n], *i = new float[n];
+            std::copy(re, re + n, r);
+            std::copy(im, im + n, i);
+            fft_split(n, r, i, work, tw, inverse);
+            double err = rmsError(n, r, i, refRe, refIm);
+            ok &= report(inverse ? "inverse split FFT" : "split FFT", n, err);
+            worst = std::max(worst, err);
+
+            for (int j = 0; j < n; ++j) {
+                data[2 * j] = re[j];
+                data[2 * j + 1] = im[j];
+            }
+            fft_interleaved(n, data, work, tw, inverse);
+            for (int j = 0; j < n; ++j) {
+                r[j] = data[2 * j];
+                i[j] = data[2 * j + 1];
+            }
+            err = rmsError(n, r, i, refRe, refIm);
+            ok &= report(inverse ? "inverse interleaved FFT" :
+                         "interleaved FFT", n, err);
+            worst = std::max(worst, err);
+            delete[] r;
+            delete[] i;
+        }
+
+        // A batch of 3 copies of the same data must give 3 copies of the
+        // single transform.
+        const int count = 3;
+        float *batch = new float[2 * count * n];
+        for (int b = 0; b < count; ++b)
+            for (int j = 0; j < n; ++j) {
+                batch[2 * (b * n + j)] = re[j];
+                batch[2 * (b * n + j) + 1] = im[j];
+            }
+        std::copy(batch, batch + 2 * n, data);
+        fft_batch_interleaved(n, count, batch, tw, false);
+        fft_interleaved(n, data, work, tw, false);
+        for (int b = 0; b < count; ++b)
+            if (memcmp(batch + 2 * b * n, data, 2 * n * sizeof(float)) != 0) {
+                printf("Error: batched FFT, n = %d: transform %d differs "
+                       "from the single one\n", n, b);
+                ok = false;
+            }
+
+        delete[] batch;
+        delete[] tw;
+        delete[] re;
+        delete[] im;
+        delete[] data;
+        delete[] work;
+        delete[] refRe;
+        delete[] refIm;
+    }
+    printf("1D FFT accuracy:\t\tworst relative RMS error %.2g\n", worst);
+    return ok;
+}
+
+
+// Checks the 2D transform against row and column naive DFTs, including
+// widths that are not multiples of the column block size, and a round trip
+// through the inverse.
+static bool
+check2D() {
+    static const int sizes[][2] = {
+        { 1, 1 }, { 4, 2 }, { 8, 32 }, { 64, 16 }, { 128, 8 }, { 256, 256 }
+    };
+    bool ok = true;
+    double worst = 0;
+    for (unsigned int t = 0; t < sizeof(sizes) / sizeof(sizes[0]); ++t) {
+        int width = sizes[t][0], height = sizes[t][1], size = width * height;
+        float *twRows = makeTwiddles(width), *twCols = makeTwiddles(height);
+        float *re = new float[size], *im = new float[size];
+        float *r = new float[size], *i = new float[size];
+        double *rowRe = new double[size], *rowIm = new double[size];
+        double *refRe = new double[size], *refIm = new double[size];
+        fillRandom(re, size);
+        fillRandom(im, size);
+
+        for (int y = 0; y < height; ++y)
+            naiveDFT(width, re + y * width, im + y * width, 1,
+                     rowRe + y * width, rowIm + y * width, false);
+        // The column pass takes the row results rounded to float, so that
+        // only the error of the column transform is added.
+        for (int j = 0; j < size; ++j) {
+            r[j] = float(rowRe[j]);
+            i[j] = float(rowIm[j]);
+        }
+        for (int x = 0; x < width; ++x)
+            naiveDFT(height, r + x, i + x, width, refRe + x, refIm + x, false);
+
+        std::copy(re, re + size, r);
+        std::copy(im, im + size, i);
+        fft2d_split(width, height, r, i, twRows, twCols, false);
+        double err = rmsError(size, r, i, refRe, refIm);
+        ok &= report("2D FFT", size, err);
+        worst = std::max(worst, err);
+
+        fft2d_split(width, height, r, i, twRows, twCols, true);
+        for (int j = 0; j < size; ++j) {
+            r[j] /= size;
+            i[j] /= size;
+            refRe[j] = re[j];
+            refIm[j] = im[j];
+        }
+        err = rmsError(size, r, i, refRe, refIm);
+        ok &= report("2D FFT round trip", size, err);
+        worst = std::max(worst, err);
+
+        delete[] twRows;
+        delete[] twCols;
+        delete[] re;
+        delete[] im;
+        delete[] r;
+        delete[] i;
+        delete[] rowRe;
+        delete[] rowIm;
+        delete[] refRe;
+        delete[] refIm;
+    }
+    printf("2D FFT accuracy:\t\tworst relative RMS error %.2g\n", worst);
+    return ok;
+}
+
+
+// Reports the time for the given number of n-point transforms, along with
+// the conventional 5 n log2(n) flops per transform rate.
+static void
+printRate(const char *name, double mcycles, double seconds, int n,
+          double count) {
+    double flops = 5. * n * log(double(n)) / log(2.) * count;
+    printf("[fft %s]:\t\t[%.3f] million cycles, %.2f GFLOP/s, "
+           "%.3g transforms/s\n", name, mcycles, flops / seconds * 1e-9,
+           count / seconds);
+}
+
+
+int main(int argc, char *argv[]) {
+    int log2n = 16, iterations = 3;
+    for (int a = 1; a < argc; ++a) {
+        if (strncmp(argv[a], "--log2n=", 8) == 0)
+            log2n = atoi(argv[a] + 8);
+        else if (strncmp(argv[a], "--iterations=", 13) == 0)
+            iterations = atoi(argv[a] + 13);
+        else {
+            fprintf(stderr, "usage: fft [--log2n=<log2 of 1D size>] "
+                    "[--iterations=<count>]\n");
+            return 1;
+        }
+    }
+    if (log2n < 1 || log2n > 26) {
+        fprintf(stderr, "fft: --log2n must be between 1 and 26\n");
+        return 1;
+    }
+    if (iterations < 1) {
+        fprintf(stderr, "fft: --iterations must be at least 1\n");
+        return 1;
+    }
+
+    bool ok = check1D();
+    ok &= check2D();
+
+    //
+    // Single 1D transforms of length n, in each format, and the serial
+    // radix-2 version for comparison.
+    //
+    int n = 1 << log2n;
+    float *tw = makeTwiddles(n), *serialTw = new float[n];
+    fft_serial_twiddles(n, serialTw);
+    float *re = new float[n], *im = new float[n], *data = new float[2 * n];
+    float *serialRe = new float[n], *serialIm = new float[n];
+    float *inputRe = new float[n], *inputIm = new float[n];
+    float *work = new float[4 * n];
+    fillRandom(inputRe, n);
+    fillRandom(inputIm, n);
+
+    // Each run starts from the same input, so that repeated transforms
+    // don't grow the values without bound.
+    double minSplit = 1e30, minSplitSec = 1e30;
+    double minInter = 1e30, minInterSec = 1e30;
+    double minSerial = 1e30, minSerialSec = 1e30;
+    for (int it = 0; it < iterations; ++it) {
+        std::copy(inputRe, inputRe + n, re);
+        std::copy(inputIm, inputIm + n, im);
+        reset_and_start_timer();
+        fft_split(n, re, im, work, tw, false);
+        double dt = get_elapsed_mcycles();
+        minSplit = std::min(minSplit, dt);
+        minSplitSec = std::min(minSplitSec, get_elapsed_sec());
+
+        for (int j = 0; j < n; ++j) {
+            data[2 * j] = inputRe[j];
+            data[2 * j + 1] = inputIm[j];
+        }
+        reset_and_start_timer();
+        fft_interleaved(n, data, work, tw, false);
+        dt = get_elapsed_mcycles();
+        minInter = std::min(minInter, dt);
+        minInterSec = std::min(minInterSec, get_elapsed_sec());
+
+        std::copy(inputRe, inputRe + n, serialRe);
+        std::copy(inputIm, inputIm + n, serialIm);
+        reset_and_start_timer();
+        fft_serial(n, serialRe, serialIm, work, work + n, serialTw);
+        dt = get_elapsed_mcycles();
+        minSerial = std::min(minSerial, dt);
+        minSerialSec = std::min(minSerialSec, get_elapsed_sec());
+    }
+
+    // The serial and ispc versions round differently, so compare them
+    // with the same tolerance as the naive DFT.
+    double *ref = new double[2 * n];
+    for (int j = 0; j < n; ++j) {
+        ref[j] = serialRe[j];
+        ref[n + j] = serialIm[j];
+    }
+    ok &= report("split FFT vs. serial", n, rmsError(n, re, im, ref, ref + n));
+    delete[] ref;
+
+    printf("1D FFT, n = %d:\n", n);
+    printRate("ispc split", minSplit, minSplitSec, n, 1);
+    printRate("ispc interleaved", minInter, minInterSec, n, 1);
+    printRate("serial split", minSerial, minSerialSec, n, 1);
+    printf("\t\t\t\t(%.2fx speedup from ISPC)\n", minSerial / minSplit);
+
+    //
+    // A batch of 1024-point transforms, and a 1024 x 1024 2D transform,
+    // both spread over the cores with tasks.
+    //
+    const int batchN = 1024, batchCount = 4096;
+    float *batchTw = makeTwiddles(batchN);
+    const int batchSize = 2 * batchN * batchCount;
+    float *batch = new float[batchSize], *batchInput = new float[batchSize];
+    fillRandom(batchInput, batchSize);
+    // As above, every run transforms the same input.
+    double minBatch = 1e30, minBatchSec = 1e30;
+    for (int it = 0; it < iterations; ++it) {
+        std::copy(batchInput, batchInput + batchSize, batch);
+        reset_and_start_timer();
+        fft_batch_interleaved(batchN, batchCount, batch, batchTw, false);
+        double dt = get_elapsed_mcycles();
+        minBatch = std::min(minBatch, dt);
+        minBatchSec = std::min(minBatchSec, get_elapsed_sec());
+    }
+    printf("%d batched FFTs, n = %d:\n", batchCount, batchN);
+    printRate("ispc + tasks interleaved", minBatch, minBatchSec, batchN,
+              batchCount);
+
+    // The 2D transform reuses the batch buffer for its split planes.
+    float *planeRe = batch, *planeIm = batch + batchN * batchN;
+    double min2D = 1e30, min2DSec = 1e30;
+    for (int it = 0; it < iterations; ++it) {
+        std::copy(batchInput, batchInput + 2 * batchN * batchN, batch);
+        reset_and_start_timer();
+        fft2d_split(batchN, batchN, planeRe, planeIm, batchTw, batchTw, false);
+        double dt = get_elapsed_mcycles();
+        min2D = std::min(min2D, dt);
+        min2DSec = std::min(min2DSec, get_elapsed_sec());
+    }
+    printf("2D FFT, %d x %d:\n", batchN, batchN);
+    // 2D: n rows and n columns of n-point transforms.
+    printRate("ispc + tasks 2D split", min2D, min2DSec, batchN, 2. * batchN);
+
+    delete[] tw;
+    delete[] serialTw;
+    delete[] re;
+    delete[] im;
+    delete[] data;
+    delete[] serialRe;
+    delete[] serialIm;
+    delete[] inputRe;
+    delete[] inputIm;
+    delete[] work;
+    delete[] batchTw;
+    delete[] batch;
+    delete[] batchInput;
+    return ok ? 0 : 1;
+}
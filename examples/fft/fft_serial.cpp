@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 2010-2014, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+#include <math.h>
+#include <algorithm>
+
+static const double TWO_PI = 6.283185307179586;
+
+// Fills tw with the n/2 twiddle factors exp(-2 pi i k / n) used by
+// fft_serial(): real parts first, then imaginary parts.
+void
+fft_serial_twiddles(int n, float tw[]) {
+    for (int k = 0; k < n / 2; ++k) {
+        double angle = -TWO_PI * k / n;
+        tw[k] = float(cos(angle));
+        tw[n / 2 + k] = float(sin(angle));
+    }
+}
+
+
+// Radix-2 Stockham FFT of (re, im) in place; (wr, wi) is scratch space of
+// the same length.
+void
+fft_serial(int n, float re[], float im[], float wr[], float wi[],
+           const float tw[]) {
+    float *xr = re, *xi = im, *yr = wr, *yi = wi;
+    for (int len = n, s = 1; len >= 2; len /= 2, s *= 2) {
+        int m = len / 2;
+        for (int p = 0; p < m; ++p) {
+            float w_r = tw[p * s], w_i = tw[n / 2 + p * s];
+            for (int q = 0; q < s; ++q) {
+                float ar = xr[q + s * p], ai = xi[q + s * p];
+                float br = xr[q + s * (p + m)], bi = xi[q + s * (p + m)];
+                float dr = ar - br, di = ai - bi;
+                yr[q + s * 2 * p] = ar + br;
+                yi[q + s * 2 * p] = ai + bi;
+                yr[q + s * (2 * p + 1)] = dr * w_r - di * w_i;
+                yi[q + s * (2 * p + 1)] = dr * w_i + di * w_r;
+            }
+        }
+        std::swap(xr, yr);
+        std::swap(xi, yi);
+    }
+    if (xr != re) {
+        std::copy(xr, xr + n, re);
+        std::copy(xi, xi + n, im);
+    }
+}
@@ -0,0 +1,287 @@
+/*
+  Copyright (c) 2010-2014, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+#pragma warning (disable: 4244)
+#pragma warning (disable: 4305)
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#ifdef HAVE_CBLAS
+#include <cblas.h>
+#endif
+#include "../timing.h"
+#include "gemm_ispc.h"
+using namespace ispc;
+
+
+// Per-precision entry points, so that the driver below can be written
+// once for both float and double.
+template <typename T> struct Gemm;
+
+template <> struct Gemm<float> {
+    static const char *name() { return "sgemm"; }
+    static double epsilon() { return 1.2e-7; }
+    static void blocked(int M, int N, int K, float alpha, const float A[],
+                        int lda, const float B[], int ldb, float beta,
+                        float C[], int ldc) {
+        sgemm_ispc(M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+    static void naive(int M, int N, int K, float alpha, const float A[],
+                      int lda, const float B[], int ldb, float beta,
+                      float C[], int ldc) {
+        sgemm_naive_ispc(M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+    static int registerTile(int dims[2]) { return sgemm_register_tile(dims); }
+#ifdef HAVE_CBLAS
+    static void blas(int M, int N, int K, float alpha, const float A[],
+                     int lda, const float B[], int ldb, float beta,
+                     float C[], int ldc) {
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, M, N, K,
+                    alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+#endif
+};
+
+template <> struct Gemm<double> {
+    static const char *name() { return "dgemm"; }
+    static double epsilon() { return 2.3e-16; }
+    static void blocked(int M, int N, int K, double alpha, const double A[],
+                        int lda, const double B[], int ldb, double beta,
+                        double C[], int ldc) {
+        dgemm_ispc(M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+    static void naive(int M, int N, int K, double alpha, const double A[],
+                      int lda, const double B[], int ldb, double beta,
+                      double C[], int ldc) {
+        dgemm_naive_ispc(M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+    static int registerTile(int dims[2]) { return dgemm_register_tile(dims); }
+#ifdef HAVE_CBLAS
+    static void blas(int M, int N, int K, double alpha, const double A[],
+                     int lda, const double B[], int ldb, double beta,
+                     double C[], int ldc) {
+        cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, M, N, K,
+                    alpha, A, lda, B, ldb, beta, C, ldc);
+    }
+#endif
+};
+
+
+template <typename T> static void
+fillRandom(T *v, int count) {
+    for (int i = 0; i < count; ++i)
+        v[i] = T(rand()) / T(RAND_MAX) - T(0.5);
+}
+
+
+// Computes C = alpha * A * B + beta * C serially, accumulating in double.
+template <typename T> static void
+gemmSerial(int M, int N, int K, T alpha, const T A[], int lda,
+           const T B[], int ldb, T beta, T C[], int ldc) {
+    for (int i = 0; i < M; ++i)
+        for (int j = 0; j < N; ++j) {
+            double sum = 0;
+            for (int k = 0; k < K; ++k)
+                sum += double(A[i * lda + k]) * double(B[k * ldb + j]);
+            double c = (beta == 0) ? 0. : double(beta) * C[i * ldc + j];
+            C[i * ldc + j] = T(alpha * sum + c);
+        }
+}
+
+
+// Returns the largest difference between the M x N matrices a and b,
+// relative to the magnitude of the entries of b.
+template <typename T> static double
+maxError(int M, int N, const T a[], const T b[], int ld) {
+    double err = 0, scale = 0;
+    for (int i = 0; i < M; ++i)
+        for (int j = 0; j < N; ++j) {
+            err = std::max(err, fabs(double(a[i * ld + j]) - double(b[i * ld + j])));
+            scale = std::max(scale, fabs(double(b[i * ld + j])));
+        }
+    return (scale > 0) ? err / scale : err;
+}
+
+
+// Runs the blocked kernel on a few shapes that are not multiples of the
+// register or cache tiles, with leading dimensions larger than the
+// matrices and nonzero beta, and compares with the serial version.
+template <typename T> static bool
+checkEdges() {
+    static const int shapes[][3] = {
+        { 1, 1, 1 }, { 7, 5, 3 }, { 37, 53, 61 }, { 101, 300, 17 },
+        { 250, 19, 513 }, { 97, 259, 300 }
+    };
+    bool ok = true;
+    for (unsigned int s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+        int M = shapes[s][0], N = shapes[s][1], K = shapes[s][2];
+        int lda = K + 3, ldb = N + 5, ldc = N + 2;
+        T *A = new T[M * lda], *B = new T[K * ldb];
+        T *C = new T[M * ldc], *Cref = new T[M * ldc];
+        fillRandom(A, M * lda);
+        fillRandom(B, K * ldb);
+        fillRandom(C, M * ldc);
+        memcpy(Cref, C, M * ldc * sizeof(T));
+
+        Gemm<T>::blocked(M, N, K, T(1.5), A, lda, B, ldb, T(-0.5), C, ldc);
+        gemmSerial<T>(M, N, K, T(1.5), A, lda, B, ldb, T(-0.5), Cref, ldc);
+
+        double err = maxError(M, N, C, Cref, ldc);
+        // The padding between rows must be left alone.
+        bool padOk = true;
+        for (int i = 0; i < M; ++i)
+            for (int j = N; j < ldc; ++j)
+                padOk &= (C[i * ldc + j] == Cref[i * ldc + j]);
+        if (err > 8 * K * Gemm<T>::epsilon() || !padOk) {
+            printf("Error: %s %dx%dx%d: relative error %g%s\n", Gemm<T>::name(),
+                   M, N, K, err, padOk ? "" : ", padding overwritten");
+            ok = false;
+        }
+        delete[] A;
+        delete[] B;
+        delete[] C;
+        delete[] Cref;
+    }
+    return ok;
+}
+
+
+static void
+printRate(const char *name, const char *version, double minCycles,
+          double minSeconds, int n) {
+    double flops = 2. * double(n) * double(n) * double(n);
+    printf("[%s %s]:\t\t[%.3f] million cycles, %.2f GFLOP/s\n", name,
+           version, minCycles, flops / minSeconds * 1e-9);
+}
+
+
+// Times the naive and blocked kernels (and the system BLAS, if there is
+// one) on n x n matrices; returns false if the results disagree.
+template <typename T> static bool
+runGemm(int n, int iterations) {
+    const char *name = Gemm<T>::name();
+    int dims[2];
+    Gemm<T>::registerTile(dims);
+    printf("%s: %d x %d matrices, %d x %d register tile\n", name, n, n,
+           dims[0], dims[1]);
+
+    T *A = new T[n * n], *B = new T[n * n];
+    T *Cnaive = new T[n * n], *Cblocked = new T[n * n];
+    fillRandom(A, n * n);
+    fillRandom(B, n * n);
+
+    double minNaive = 1e30, minNaiveSec = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        reset_and_start_timer();
+        Gemm<T>::naive(n, n, n, T(1), A, n, B, n, T(0), Cnaive, n);
+        double dt = get_elapsed_mcycles();
+        minNaive = std::min(minNaive, dt);
+        minNaiveSec = std::min(minNaiveSec, get_elapsed_sec());
+    }
+    printRate(name, "naive ispc + tasks", minNaive, minNaiveSec, n);
+
+    double minBlocked = 1e30, minBlockedSec = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        reset_and_start_timer();
+        Gemm<T>::blocked(n, n, n, T(1), A, n, B, n, T(0), Cblocked, n);
+        double dt = get_elapsed_mcycles();
+        minBlocked = std::min(minBlocked, dt);
+        minBlockedSec = std::min(minBlockedSec, get_elapsed_sec());
+    }
+    printRate(name, "blocked ispc + tasks", minBlocked, minBlockedSec, n);
+    printf("\t\t\t\t(%.2fx speedup from blocking)\n", minNaive / minBlocked);
+
+#ifdef HAVE_CBLAS
+    T *Cblas = new T[n * n];
+    double minBlas = 1e30, minBlasSec = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        reset_and_start_timer();
+        Gemm<T>::blas(n, n, n, T(1), A, n, B, n, T(0), Cblas, n);
+        double dt = get_elapsed_mcycles();
+        minBlas = std::min(minBlas, dt);
+        minBlasSec = std::min(minBlasSec, get_elapsed_sec());
+    }
+    printRate(name, "cblas", minBlas, minBlasSec, n);
+    printf("\t\t\t\t(blocked ispc runs at %.0f%% of the BLAS rate)\n",
+           100. * minBlasSec / minBlockedSec);
+    delete[] Cblas;
+#endif
+
+    // Both ispc versions sum the same products in the same order of k, but
+    // the blocked one does so in KC-deep partial sums, so they are only
+    // expected to agree to within rounding.
+    double err = maxError(n, n, Cblocked, Cnaive, n);
+    bool ok = err <= 8 * n * Gemm<T>::epsilon();
+    if (!ok)
+        printf("Error: %s blocked and naive results differ by %g\n", name, err);
+
+    delete[] A;
+    delete[] B;
+    delete[] Cnaive;
+    delete[] Cblocked;
+    return ok;
+}
+
+
+static void usage() {
+    fprintf(stderr, "usage: gemm [--size=<n>] [--iterations=<count>]\n");
+    exit(1);
+}
+
+
+int main(int argc, char *argv[]) {
+    int n = 1024, iterations = 3;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--size=", 7) == 0)
+            n = atoi(argv[i] + 7);
+        else if (strncmp(argv[i], "--iterations=", 13) == 0)
+            iterations = atoi(argv[i] + 13);
+        else
+            usage();
+    }
+    if (n <= 0 || iterations <= 0)
+        usage();
+
+    bool ok = checkEdges<float>();
+    ok &= checkEdges<double>();
+    ok &= runGemm<float>(n, iterations);
+    ok &= runGemm<double>(n, iterations);
+    return ok ? 0 : 1;
+}
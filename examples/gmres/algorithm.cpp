@@ -153,7 +153,8 @@ void update_qr_decomp (DenseMatrix &H, Vector &s, size_t col, Vector &Cn, Vector
     apply_rotation( s, col, Cn, Sn);
 }
 
-void gmres (const Matrix &A, const Vector &b, Vector &x, int num_iters, double max_err)  
+int gmres (const Matrix &A, const Vector &b, Vector &x, int num_iters, double max_err,
+           const Preconditioner *M)
 {
     DEBUG_PRINT("gmres starting!\n");
     x.zero();
@@ -182,13 +183,19 @@ void gmres (const Matrix &A, const Vector &b, Vector &x, int num_iters, double m
 
     int iter = 0;
     Vector temp(A.rows(), false);
+    Vector z(A.rows());
     double rel_err;
 
     while (iter < num_iters) 
     {
-        // w = Aqi
+        // w = Aqi (or A M^-1 qi)
         Qstar.row(iter, temp);
-        A.multiply(temp, w);
+        if (M != NULL) {
+            M->apply(temp, z);
+            A.multiply(z, w);
+        }
+        else
+            A.multiply(temp, w);
 
         // construct ith column of H, i+1th row of Qstar:        
         for (int row = 0; row <= iter; row++) {
@@ -216,16 +223,22 @@ void gmres (const Matrix &A, const Vector &b, Vector &x, int num_iters, double m
 
     if (iter == num_iters) {
         fprintf(stderr, "Error: gmres failed to converge in %d iterations (relative err: %f)\n", num_iters, rel_err);
-        exit(-1);
+        return -1;
     }
 
     // We've reached an acceptable solution (?):
 
-    DEBUG_PRINT("gmres completed in %d iterations (rel. resid. %f, max %f)\n", num_iters, rel_err, max_err);
+    DEBUG_PRINT("gmres completed in %d iterations (rel. resid. %f, max %f)\n", iter + 1, rel_err, max_err);
     Vector y(iter+1);
     upper_triangular_right_solve(H, G, y);
     for (int i = 0; i < iter + 1; i++) {
         Qstar.row(i, temp);
         x.add_ax(y[i], temp);
     }
+
+    if (M != NULL) {
+        z.copy(x);
+        M->apply(z, x);
+    }
+    return iter + 1;
 }
@@ -36,14 +36,19 @@
 #define __ALGORITHM_H__
 
 #include "matrix.h"
+#include "preconditioner.h"
 
 
 /* Generalized Minimal Residual Method:
  * -----------------------------------
  * Takes a square matrix and an rhs and uses GMRES to find an estimate for x.
- * The specified error is relative.
+ * The specified error is relative.  If a preconditioner M is given, it is
+ * applied on the right, i.e. GMRES solves A M^-1 y = b and x = M^-1 y, so
+ * that the error is still that of A x = b.  Returns the number of
+ * iterations, or -1 if GMRES failed to converge within num_iters of them.
  */
-void gmres (const Matrix &A, const Vector &b, Vector &x, int num_iters, double err);
+int gmres (const Matrix &A, const Vector &b, Vector &x, int num_iters, double err,
+           const Preconditioner *M = NULL);
 
 
 
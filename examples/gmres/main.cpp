@@ -37,43 +37,150 @@
 #include "util.h"
 #include <cmath>
 #include "../timing.h"
+#include <algorithm>
+
+
+/* Times repeated sparse matrix-vector products with the CSR kernel (one
+ * row per program instance) and with the SELL-C-sigma kernels, and checks
+ * that they agree.
+ */
+static void spmv_benchmark (const CRSMatrix &A, const SELLMatrix &S)
+{
+    Vector v(A.cols()), r_csr(A.rows()), r_sell(A.rows());
+    for (int i = 0; i < A.cols(); i++)
+        v[i] = 1.0 + (i % 7) * 0.125;
+
+    // Enough products for about 1e8 multiply-adds.
+    int reps = std::max(10, (int)(100000000 / std::max((size_t)1, A.nonzeroes())));
+
+    reset_and_start_timer();
+    for (int i = 0; i < reps; i++)
+        A.multiply(v, r_csr);
+    double csr_cycles = get_elapsed_mcycles();
+    printf("[spmv csr]:\t\t\t[%.3f] million cycles (%d products)\n",
+           csr_cycles, reps);
+
+    const char *names[] = { "sell 1 core", "sell + tasks", "sell + tasks + prefetch" };
+    for (int variant = 0; variant < 3; variant++) {
+        bool tasks = (variant > 0);
+        int prefetch_distance = (variant == 2) ? 8 : 0;
+
+        reset_and_start_timer();
+        for (int i = 0; i < reps; i++)
+            S.multiply(v, r_sell, tasks, prefetch_distance);
+        double sell_cycles = get_elapsed_mcycles();
+
+        double max_diff = 0;
+        for (int i = 0; i < A.rows(); i++)
+            max_diff = std::max(max_diff, fabs(r_sell[i] - r_csr[i]));
+        printf("[spmv %s]:\t[%.3f] million cycles (%.2fx speedup, max diff %g)\n",
+               names[variant], sell_cycles, csr_cycles / sell_cycles, max_diff);
+    }
+    printf("\t\t\t\t(%lu nonzeroes, %lu stored in SELL-%d-256 format)\n",
+           A.nonzeroes(), S.stored(), ispc::sell_slice_height());
+}
+
+
+static const char *precond_names[] = { "none", "jacobi", "block-jacobi", "ilu0" };
+#define NUM_PRECONDS 4
 
 
 int main (int argc, char **argv) 
 {
-    if (argc < 4) {
-        printf("usage: %s <input-matrix> <input-rhs> <output-file>\n", argv[0]);
+    // The solution written out is the one computed with this preconditioner.
+    int selected = 3;
+    const char *cache_dir = NULL;
+    int arg = 1;
+    bool valid = true;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        if (strncmp(argv[arg], "--precond=", 10) == 0) {
+            for (selected = 0; selected < NUM_PRECONDS; selected++)
+                if (strcmp(argv[arg] + 10, precond_names[selected]) == 0)
+                    break;
+            valid = valid && selected < NUM_PRECONDS;
+        }
+        else if (strncmp(argv[arg], "--cache-dir=", 12) == 0)
+            cache_dir = argv[arg] + 12;
+        else
+            valid = false;
+    }
+    if (argc - arg < 3 || !valid) {
+        printf("usage: %s [--precond=none|jacobi|block-jacobi|ilu0] [--cache-dir=<dir>] <input-matrix> <input-rhs> <output-file>\n", argv[0]);
         return -1;
     }
 
-    double gmres_cycles;
-
     DEBUG_PRINT("Loading A...\n");
-    Matrix *A = CRSMatrix::matrix_from_mtf(argv[1]);
+    reset_and_start_timer();
+    CRSMatrix *A = CRSMatrix::matrix_from_mtf(argv[arg], cache_dir);
     if (A == NULL) 
         return -1;
+    double load_cycles = get_elapsed_mcycles();
+    printf("[load A (%s)]:\t[%.3f] million cycles\n",
+           A->mapped() ? "mapped CSR cache" : "parsed text", load_cycles);
     DEBUG_PRINT("... size: %lu\n", A->cols());
 
+    SELLMatrix S(*A);
+    spmv_benchmark(*A, S);
+
     DEBUG_PRINT("Loading b...\n");
-    Vector *b = Vector::vector_from_mtf(argv[2]);
+    Vector *b = Vector::vector_from_mtf(argv[arg+1]);
     if (b == NULL)
         return -1;
 
+    //
+    // Solve with each of the preconditioners, reporting the time to
+    // solution: the preconditioner setup plus the GMRES iterations.
+    //
     Vector x(A->cols());
-    DEBUG_PRINT("Beginning gmres...\n");
-    gmres(*A, *b, x, A->cols() / 2, .01);
+    Vector resid(A->rows());
+    int status = 0;
+    for (int kind = 0; kind < NUM_PRECONDS; kind++) {
+        DEBUG_PRINT("Beginning gmres (preconditioner: %s)...\n", precond_names[kind]);
+        Vector xk(A->cols());
+
+        reset_and_start_timer();
+        Preconditioner *M = NULL;
+        ILU0Preconditioner *ilu0 = NULL;
+        if (kind == 1)
+            M = new JacobiPreconditioner(*A);
+        else if (kind == 2)
+            M = new BlockJacobiPreconditioner(*A);
+        else if (kind == 3)
+            M = ilu0 = new ILU0Preconditioner(*A);
+        double setup_cycles = get_elapsed_mcycles();
+
+        reset_and_start_timer();
+        int iters = gmres(S, *b, xk, A->cols() / 2, .01, M);
+        double solve_cycles = get_elapsed_mcycles();
+
+        // Compute residual (double-check)
+        S.multiply(xk, resid);
+        resid.subtract(*b);
+        double rel_resid = resid.norm() / b->norm();
+
+        if (iters < 0)
+            printf("[gmres, %s]:\tfailed to converge after [%.3f] million cycles\n",
+                   precond_names[kind], setup_cycles + solve_cycles);
+        else
+            printf("[gmres, %s]:\t[%.3f] million cycles to solution (setup %.3f, "
+                   "%d iterations, rel. resid. %.3g)\n", precond_names[kind],
+                   setup_cycles + solve_cycles, setup_cycles, iters, rel_resid);
+        if (ilu0 != NULL)
+            printf("\t\t\t\t(ILU(0) level schedules: %d levels for L, %d for U)\n",
+                   ilu0->lower_levels(), ilu0->upper_levels());
+
+        if (kind == selected) {
+            if (iters < 0)
+                status = -1;
+            else
+                x.copy(xk);
+        }
+        delete M;
+    }
+    if (status != 0)
+        return status;
 
     // Write result out to file
     x.to_mtf(argv[argc-1]);
-
-    // Compute residual (double-check)
-#ifdef DEBUG
-    Vector bprime(b->size());
-    A->multiply(x, bprime);
-    Vector resid(bprime.size(), &(bprime[0]));
-    resid.subtract(*b);
-    DEBUG_PRINT("residual error check: %lg\n", resid.norm() / b->norm());
-#endif
-    // Print profiling results
-    DEBUG_PRINT("-- Total mcycles to solve : %.03f --\n", gmres_cycles);
+    return 0;
 }
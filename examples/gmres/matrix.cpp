@@ -76,121 +76,293 @@ void DenseMatrix::set_row(size_t row, const Vector &v)
 \**************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <vector>
 #include <algorithm>
+#include "../mapped_file.h"
 
 
-struct entry {
-    int row;
-    int col;
-    double val;
+#define ERR_OUT(...) { fprintf(stderr, __VA_ARGS__); return NULL; }
+
+
+/* The data lines of a Matrix Market file, as read by read_mtx(). */
+struct MtxData {
+    MM_typecode      matcode;
+    int              rows, cols, nonzeroes;
+    std::vector<int>    row, col;    // 0-based; coordinate files only
+    std::vector<double> val;
 };
 
-bool compare_entries(struct entry i, struct entry j) {
-    if (i.row < j.row)
-        return true;
-    if (i.row > j.row)
+// Line status codes returned by ispc::mtx_parse_lines()
+#define MTX_LINE_OK      0
+#define MTX_LINE_INEXACT 1
+#define MTX_LINE_INVALID 2
+
+// Bytes of text per task when looking for line boundaries
+#define MTX_CHUNK_SIZE (1 << 20)
+
+/* Reads the banner and size line of a Matrix Market file with mmio, then
+ * maps the file and parses the data lines in parallel with ispc: the text
+ * is split into chunks whose lines are found by separate tasks, and the
+ * lines are then parsed one per program instance.  The few numbers that
+ * the ispc parser can't convert exactly are converted again with sscanf.
+ */
+static bool read_mtx (const char *path, MtxData &data)
+{
+    FILE *f;
+    if ((f = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "Error: %s does not name a valid/readable file.\n", path);
+        return false;
+    }
+    bool ok = (mm_read_banner(f, &data.matcode) == 0);
+    if (!ok)
+        fprintf(stderr, "Error: Could not process Matrix Market banner.\n");
+    else if (mm_is_complex(data.matcode) || mm_is_pattern(data.matcode)) {
+        fprintf(stderr, "Error: Application only supports real and integer matrices.\n");
+        ok = false;
+    }
+    else if (mm_is_dense(data.matcode)) {
+        ok = (mm_read_mtx_array_size(f, &data.rows, &data.cols) == 0);
+        data.nonzeroes = data.rows * data.cols;
+    }
+    else
+        ok = (mm_read_mtx_crd_size(f, &data.rows, &data.cols, &data.nonzeroes) == 0);
+    if (!ok)
+        fprintf(stderr, "Error: could not read matrix size from file.\n");
+    long data_offset = ftell(f);
+    fclose(f);
+    if (!ok)
         return false;
 
-    return i.col < j.col;
+    MappedFile file;
+    if (!file.openRaw(path) || data_offset < 0 || (size_t)data_offset > file.size()) {
+        fprintf(stderr, "Error: could not map %s.\n", path);
+        return false;
+    }
+    const int8_t *text = (const int8_t *)file.data() + data_offset;
+    int64_t length = file.size() - data_offset;
+
+    // Find the start of every line.
+    int num_chunks = (int)((length + MTX_CHUNK_SIZE - 1) / MTX_CHUNK_SIZE);
+    std::vector<int> newlines_before(num_chunks + 1, 0);
+    if (num_chunks > 0)
+        ispc::mtx_count_lines(text, length, MTX_CHUNK_SIZE, &newlines_before[1]);
+    for (int i = 0; i < num_chunks; i++)
+        newlines_before[i + 1] += newlines_before[i];
+    int num_newlines = newlines_before[num_chunks];
+    std::vector<int> scratch(num_newlines + 1);
+    std::vector<int64_t> line_starts(num_newlines + 1, 0);
+    if (num_chunks > 0)
+        ispc::mtx_line_starts(text, length, MTX_CHUNK_SIZE, &newlines_before[0],
+                              &scratch[0], &line_starts[0]);
+
+    int num_lines = num_newlines + ((length > 0 && text[length - 1] != '\n') ? 1 : 0);
+    if (num_lines < data.nonzeroes) {
+        fprintf(stderr, "Error: %s has %d data lines, expected %d.\n", path,
+                num_lines, data.nonzeroes);
+        return false;
+    }
+
+    // Parse the lines.
+    bool coordinate = mm_is_coordinate(data.matcode);
+    int n = data.nonzeroes;
+    std::vector<int> status(n);
+    data.val.resize(n);
+    data.row.resize(coordinate ? n : 1);
+    data.col.resize(coordinate ? n : 1);
+    if (n > 0)
+        ispc::mtx_parse_lines(text, length, &line_starts[0], num_newlines, n,
+                              coordinate, &data.row[0], &data.col[0],
+                              &data.val[0], &status[0]);
+
+    for (int i = 0; i < n; i++) {
+        if (status[i] == MTX_LINE_OK)
+            continue;
+
+        char line[256];
+        int64_t end = (i < num_newlines) ? line_starts[i + 1] : length;
+        size_t size = std::min((size_t)(end - line_starts[i]), sizeof(line) - 1);
+        memcpy(line, text + line_starts[i], size);
+        line[size] = '\0';
+
+        int row, col;
+        if (status[i] == MTX_LINE_INEXACT &&
+            (coordinate ? sscanf(line, "%d %d %lg", &row, &col, &data.val[i]) == 3 :
+                          sscanf(line, "%lg", &data.val[i]) == 1))
+            continue;
+
+        fprintf(stderr, "Error: could not parse data line %d of %s.\n", i + 1, path);
+        return false;
+    }
+
+    if (coordinate) {
+        for (int i = 0; i < n; i++) {
+            if (data.row[i] < 0 || data.row[i] >= data.rows ||
+                data.col[i] < 0 || data.col[i] >= data.cols) {
+                fprintf(stderr, "Error: entry %d of %s is out of range.\n", i + 1, path);
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-#define ERR_OUT(...) { fprintf(stderr, __VA_ARGS__); return NULL; }
 
-CRSMatrix *CRSMatrix::matrix_from_mtf (char *path) {
-    FILE *f;
-    MM_typecode matcode;
+#define CSR_CACHE_MAGIC "ISPCCSR"
+#define CSR_CACHE_VERSION 1
 
-    int m, n, nz;
+CRSMatrix::CRSMatrix (size_t size_r, size_t size_c, size_t nonzeroes,
+                      MappedFile *mapping) :
+    Matrix(size_r, size_c)
+{
+    _nonzeroes        = nonzeroes;
+    row_offsets       = (const int *)mapping->section(1);
+    columns           = (const int *)mapping->section(2);
+    entries           = (const double *)mapping->section(3);
+    this->mapping     = mapping;
+}
 
-    if ((f = fopen(path, "r")) == NULL) 
-        ERR_OUT("Error: %s does not name a valid/readable file.\n", path);
+CRSMatrix::~CRSMatrix ()
+{
+    delete mapping;
+}
 
-    if (mm_read_banner(f, &matcode) != 0)
-        ERR_OUT("Error: Could not process Matrix Market banner.\n");
+/* Cache files have four sections: the sizes (rows, columns, nonzeroes),
+ * the row offsets, the column indices and the entries.
+ */
+CRSMatrix *CRSMatrix::matrix_from_cache (const char *path, const char *source)
+{
+    MappedFile *file = new MappedFile;
+    if (!file->open(path, CSR_CACHE_MAGIC, CSR_CACHE_VERSION, source) ||
+        file->numSections() != 4 || file->sectionSize(0) != 3 * sizeof(int)) {
+        delete file;
+        return NULL;
+    }
 
-    if (mm_is_complex(matcode)) 
-        ERR_OUT("Error: Application does not support complex numbers.\n")
+    const int *sizes = (const int *)file->section(0);
+    int rows = sizes[0], cols = sizes[1], nonzeroes = sizes[2];
+    if (file->sectionSize(1) != (rows + 1) * sizeof(int) ||
+        file->sectionSize(2) != nonzeroes * sizeof(int) ||
+        file->sectionSize(3) != nonzeroes * sizeof(double)) {
+        fprintf(stderr, "%s: inconsistent cache file\n", path);
+        delete file;
+        return NULL;
+    }
+    return new CRSMatrix(rows, cols, nonzeroes, file);
+}
 
-    if (mm_is_dense(matcode))
+bool CRSMatrix::write_cache (const char *path, const char *source) const
+{
+    int sizes[3] = { (int)rows(), (int)cols(), (int)_nonzeroes };
+    const void *data[4] = { sizes, row_offsets, columns, entries };
+    uint64_t size[4] = { sizeof(sizes), (rows() + 1) * sizeof(int),
+                         _nonzeroes * sizeof(int), _nonzeroes * sizeof(double) };
+    return writeMappedFile(path, CSR_CACHE_MAGIC, CSR_CACHE_VERSION, 4, data,
+                           size, source);
+}
+
+CRSMatrix *CRSMatrix::matrix_from_mtf (char *path, const char *cache_dir) {
+    char cache_path[1024];
+    const char *name = path;
+    if (cache_dir != NULL) {
+        for (const char *p = path; *p != '\0'; p++)
+            if (*p == '/' || *p == '\\')
+                name = p + 1;
+    }
+    int length = cache_dir != NULL ?
+        snprintf(cache_path, sizeof(cache_path), "%s/%s.csr.mmap", cache_dir, name) :
+        snprintf(cache_path, sizeof(cache_path), "%s.csr.mmap", path);
+    if (length < 0 || length >= (int)sizeof(cache_path))
+        ERR_OUT("Error: path %s is too long.\n", path);
+
+    CRSMatrix *M = matrix_from_cache(cache_path, path);
+    if (M != NULL)
+        return M;
+
+    MtxData data;
+    if (!read_mtx(path, data))
+        return NULL;
+
+    if (mm_is_dense(data.matcode))
         ERR_OUT("Error: supplied matrix is dense (should be sparse.)\n");
 
-    if (!mm_is_matrix(matcode))
+    if (!mm_is_matrix(data.matcode))
         ERR_OUT("Error: %s does not encode a matrix.\n", path)
 
-    if (mm_read_mtx_crd_size(f, &m, &n, &nz) != 0)
-        ERR_OUT("Error: could not read matrix size from file.\n");
-
-    if (m != n)
+    if (data.rows != data.cols)
         ERR_OUT("Error: Application does not support non-square matrices.");
 
-    std::vector<struct entry> entries;
-    entries.resize(nz);
+    int m = data.rows, nz = data.nonzeroes;
+    if (mm_is_symmetric(data.matcode)) {
+        // Only the lower triangle is stored; mirror it.
+        for (int i = 0; i < nz; i++) {
+            if (data.row[i] != data.col[i]) {
+                data.row.push_back(data.col[i]);
+                data.col.push_back(data.row[i]);
+                data.val.push_back(data.val[i]);
+            }
+        }
+        nz = data.val.size();
+    }
 
+    // Bucket the entries by row, then sort each row by column (Matrix
+    // Market files are usually sorted by column, in which case the rows
+    // already are).
+    M = new CRSMatrix(m, data.cols, nz);
+    std::vector<int> &offsets = M->row_offset_storage;
+    for (int i = 0; i < nz; i++)
+        offsets[data.row[i] + 1]++;
+    for (int row = 0; row < m; row++)
+        offsets[row + 1] += offsets[row];
+    std::vector<int> next(offsets.begin(), offsets.end() - 1);
     for (int i = 0; i < nz; i++) {
-        fscanf(f, "%d %d %lg\n", &entries[i].row, &entries[i].col, &entries[i].val);
-        // Adjust from 1-based to 0-based
-        entries[i].row--;
-        entries[i].col--;
+        int j = next[data.row[i]]++;
+        M->column_storage[j] = data.col[i];
+        M->entry_storage[j] = data.val[i];
     }
 
-    sort(entries.begin(), entries.end(), compare_entries);
-
-    CRSMatrix *M = new CRSMatrix(m, n, nz);
-    int cur_row = -1;
-    for (int i = 0; i < nz; i++) {
-        while (entries[i].row > cur_row)
-            M->row_offsets[++cur_row] = i;
-        M->entries[i] = entries[i].val;
-        M->columns[i] = entries[i].col;
+    std::vector<std::pair<int, double> > row_entries;
+    for (int row = 0; row < m; row++) {
+        int first = offsets[row], end = offsets[row + 1];
+        bool sorted = true;
+        for (int j = first + 1; j < end; j++)
+            sorted = sorted && M->column_storage[j - 1] <= M->column_storage[j];
+        if (sorted)
+            continue;
+        row_entries.clear();
+        for (int j = first; j < end; j++)
+            row_entries.push_back(std::make_pair(M->column_storage[j], M->entry_storage[j]));
+        std::sort(row_entries.begin(), row_entries.end());
+        for (int j = first; j < end; j++) {
+            M->column_storage[j] = row_entries[j - first].first;
+            M->entry_storage[j] = row_entries[j - first].second;
+        }
     }
 
+    // The input may well be in a read-only location; the cache is only an
+    // optimization, so just go on without it if it can't be written.
+    M->write_cache(cache_path, path);
     return M;
 }
 
 Vector *Vector::vector_from_mtf (char *path) {
-    FILE *f;
-    MM_typecode matcode;
-
-    int m, n, nz;
+    MtxData data;
+    if (!read_mtx(path, data))
+        return NULL;
 
-    if ((f = fopen(path, "r")) == NULL) 
-        ERR_OUT("Error: %s does not name a valid/readable file.\n", path);
-
-    if (mm_read_banner(f, &matcode) != 0)
-        ERR_OUT("Error: Could not process Matrix Market banner.\n");
-
-    if (mm_is_complex(matcode)) 
-        ERR_OUT("Error: Application does not support complex numbers.\n")
-
-    if (mm_is_dense(matcode)) {
-        if (mm_read_mtx_array_size(f, &m, &n) != 0)
-            ERR_OUT("Error: could not read matrix size from file.\n");
-    } else {
-        if (mm_read_mtx_crd_size(f, &m, &n, &nz) != 0)
-            ERR_OUT("Error: could not read matrix size from file.\n");
-    }
-    if (n != 1)
+    if (data.cols != 1)
         ERR_OUT("Error: %s does not describe a vector.\n", path);
 
-    Vector *x = new Vector(m);
+    Vector *x = new Vector(data.rows);
 
-    if (mm_is_dense(matcode)) {
-        double val;
-        for (int i = 0; i < m; i++) {
-            fscanf(f, "%lg\n", &val);
-            (*x)[i] = val;
-        }
+    if (mm_is_dense(data.matcode)) {
+        for (int i = 0; i < data.rows; i++)
+            (*x)[i] = data.val[i];
     }
     else {
         x->zero();
-        double val;
-        int row;
-        int col;
-        for (int i = 0; i < nz; i++) {
-            fscanf(f, "%d %d %lg\n", &row, &col, &val);
-            (*x)[row-1] = val;
-        }
+        for (int i = 0; i < data.nonzeroes; i++)
+            (*x)[data.row[i]] = data.val[i];
     }
     return x;
 }
@@ -223,24 +395,113 @@ void CRSMatrix::multiply (const Vector &v, Vector &r) const
     ASSERT(v.size() == cols());
     ASSERT(r.size() == rows());
 
-    for (int row = 0; row < rows(); row++) 
-    {
-        int row_offset = row_offsets[row];
-        int next_offset = ((row + 1 == rows()) ? _nonzeroes : row_offsets[row + 1]);
+    ispc::sparse_multiply(entries, columns, row_offsets,
+                          rows(), cols(), _nonzeroes, &v[0], &r[0]);
+}
+
+void CRSMatrix::zero ( ) 
+{
+    entry_storage.clear();
+    row_offset_storage.clear();
+    column_storage.clear();
+    delete mapping;
+    mapping = NULL;
+    entries = NULL;
+    row_offsets = NULL;
+    columns = NULL;
+    _nonzeroes = 0;
+}
+
 
-        double sum = 0;
-        for (int i = row_offset; i < next_offset; i++)
-        {
-            sum += v[columns[i]] * entries[i];
+/**************************************************************\
+| SELLMatrix Methods
+\**************************************************************/
+SELLMatrix::SELLMatrix (const CRSMatrix &A, int sigma) :
+    Matrix(A.rows(), A.cols())
+{
+    const int C = ispc::sell_slice_height();
+    sigma = std::max(C, sigma / C * C);
+    num_slices = (rows() + C - 1) / C;
+
+    std::vector<int> length(rows());
+    for (int row = 0; row < rows(); row++) {
+        length[row] = A.row_offsets[row + 1] - A.row_offsets[row];
+    }
+
+    // Sort the rows by decreasing length within each window of sigma
+    // rows, so that rows of similar length share slices.  Since sigma is a
+    // multiple of C, slices never straddle windows.
+    row_perm.resize(rows());
+    for (int row = 0; row < rows(); row++)
+        row_perm[row] = row;
+    for (int w = 0; w < rows(); w += sigma) {
+        std::vector<std::pair<int, int> > window;
+        for (int row = w; row < std::min(w + sigma, (int)rows()); row++)
+            window.push_back(std::make_pair(-length[row], row));
+        std::stable_sort(window.begin(), window.end());
+        for (size_t i = 0; i < window.size(); i++)
+            row_perm[w + i] = window[i].second;
+    }
+
+    slice_offsets.resize(num_slices + 1);
+    slice_offsets[0] = 0;
+    for (int s = 0; s < num_slices; s++) {
+        int width = 0;
+        for (int lane = 0; lane < C && s * C + lane < rows(); lane++)
+            width = std::max(width, length[row_perm[s * C + lane]]);
+        slice_offsets[s + 1] = slice_offsets[s] + width * C;
+    }
+
+    // Padding entries are zero and repeat the row's last column index (or
+    // use the row's own index for empty rows), so that their gathers from
+    // the vector hit cache lines that are being read anyway.
+    entries.assign(slice_offsets[num_slices], 0.0);
+    columns.assign(slice_offsets[num_slices], 0);
+    for (int s = 0; s < num_slices; s++) {
+        int width = (slice_offsets[s + 1] - slice_offsets[s]) / C;
+        for (int lane = 0; lane < C && s * C + lane < rows(); lane++) {
+            int row = row_perm[s * C + lane];
+            int offset = A.row_offsets[row];
+            int pad_column = (length[row] > 0) ? A.columns[offset + length[row] - 1] : row;
+            for (int k = 0; k < width; k++) {
+                int j = slice_offsets[s] + k * C + lane;
+                if (k < length[row]) {
+                    entries[j] = A.entries[offset + k];
+                    columns[j] = A.columns[offset + k];
+                }
+                else
+                    columns[j] = pad_column;
+            }
         }
-        r[row] = sum;
     }
 }
 
-void CRSMatrix::zero ( ) 
+void SELLMatrix::multiply (const Vector &v, Vector &r) const
+{
+    multiply(v, r, true, 0);
+}
+
+void SELLMatrix::multiply (const Vector &v, Vector &r, bool tasks,
+                           int prefetch_distance) const
+{
+    ASSERT(v.size() == cols());
+    ASSERT(r.size() == rows());
+
+    if (tasks)
+        ispc::sell_multiply_tasks(&entries[0], &columns[0], &slice_offsets[0],
+                                  &row_perm[0], rows(), num_slices, &v[0],
+                                  &r[0], prefetch_distance);
+    else
+        ispc::sell_multiply(&entries[0], &columns[0], &slice_offsets[0],
+                            &row_perm[0], rows(), num_slices, &v[0], &r[0],
+                            prefetch_distance);
+}
+
+void SELLMatrix::zero ( ) 
 {
     entries.clear();
-    row_offsets.clear();
     columns.clear();
-    _nonzeroes = 0;
+    slice_offsets.assign(1, 0);
+    row_perm.clear();
+    num_slices = 0;
 }
@@ -48,6 +48,7 @@
 
 
 class DenseMatrix;
+class MappedFile;
 /**************************************************************\
 | Vector class
 \**************************************************************/
@@ -258,22 +259,87 @@ class CRSMatrix : public Matrix {
     Matrix(size_r, size_c) 
         {
             _nonzeroes = nonzeroes;
-            entries.resize(nonzeroes);
-            columns.resize(nonzeroes);
-            row_offsets.resize(size_r);
+            entry_storage.resize(nonzeroes);
+            column_storage.resize(nonzeroes);
+            row_offset_storage.resize(size_r + 1);
+            entries     = &entry_storage[0];
+            columns     = &column_storage[0];
+            row_offsets = &row_offset_storage[0];
+            mapping     = NULL;
         }
+    ~CRSMatrix();
 
     virtual void multiply(const Vector &v, Vector &r) const;
 
     virtual void zero();
 
-    static CRSMatrix *matrix_from_mtf (char *path);
+    size_t nonzeroes() const { return _nonzeroes; }
+
+    // Read access to the CSR arrays; row_offset(rows()) is nonzeroes().
+    int    row_offset (size_t row) const { return row_offsets[row]; }
+    int    column (size_t i) const { return columns[i]; }
+    double entry  (size_t i) const { return entries[i]; }
+
+    // Reads a Matrix Market file.  The matrix is also saved in a binary
+    // cache file, <path>.csr.mmap, or <cache_dir>/<file name>.csr.mmap if
+    // cache_dir is given; later calls map that file and use its arrays in
+    // place instead of parsing the text again, as long as the size and
+    // modification time of the text file haven't changed.  If the cache
+    // file can't be written, the parsed matrix is just used as it is.
+    static CRSMatrix *matrix_from_mtf (char *path, const char *cache_dir = NULL);
+
+    // True if the arrays are those of a mapped cache file
+    bool mapped() const { return mapping != NULL; }
+
+    friend class SELLMatrix;
 
  private:
+    CRSMatrix (size_t size_r, size_t size_c, size_t nonzeroes,
+               MappedFile *mapping);
+    CRSMatrix (const CRSMatrix &);
+    CRSMatrix &operator = (const CRSMatrix &);
+
+    static CRSMatrix *matrix_from_cache (const char *path, const char *source);
+    bool write_cache (const char *path, const char *source) const;
+
     unsigned int        _nonzeroes;
+    // These point either to the storage vectors below or into the
+    // mapped cache file; row_offsets has rows() + 1 entries.
+    const double        *entries;
+    const int           *row_offsets;
+    const int           *columns;
+    std::vector<double>  entry_storage;
+    std::vector<int>     row_offset_storage;
+    std::vector<int>     column_storage;
+    MappedFile          *mapping;
+};
+
+/**************************************************************\
+| SELLMatrix (sliced ELLPACK with row sorting, "SELL-C-sigma")
+\**************************************************************/
+class SELLMatrix : public Matrix { 
+ public:
+    // sigma is the number of consecutive rows within which rows are
+    // sorted by length; it is rounded to a multiple of the slice height.
+    SELLMatrix (const CRSMatrix &A, int sigma = 256);
+
+    // Multiplies with task parallelism and without prefetching.
+    virtual void multiply(const Vector &v, Vector &r) const;
+
+    void multiply(const Vector &v, Vector &r, bool tasks, 
+                  int prefetch_distance) const;
+
+    virtual void zero();
+
+    // Number of entries stored, including padding
+    size_t stored() const { return entries.size(); }
+
+ private:
+    int                  num_slices;
     std::vector<double>  entries;
-    std::vector<int>     row_offsets;
     std::vector<int>     columns;
+    std::vector<int>     slice_offsets;
+    std::vector<int>     row_perm;
 };
 
 #endif
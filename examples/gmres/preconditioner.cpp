@@ -0,0 +1,198 @@
+/*
+  Copyright (c) 2012-2015, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+
+/**************************************************************\
+| Includes
+\**************************************************************/
+#include <algorithm>
+
+#include "preconditioner.h"
+#include "matrix_ispc.h"
+
+
+/* Copies the CSR arrays of A, with rows + 1 row offsets.  With
+ * add_diagonal, rows that lack a diagonal entry get an explicit zero one
+ * (the columns of each row are assumed to be sorted).
+ */
+static void csr_arrays (const CRSMatrix &A, bool add_diagonal,
+                        std::vector<double> &entries,
+                        std::vector<int> &columns,
+                        std::vector<int> &row_offsets)
+{
+    entries.clear();
+    columns.clear();
+    row_offsets.resize(A.rows() + 1);
+
+    for (int row = 0; row < A.rows(); row++) {
+        row_offsets[row] = columns.size();
+        bool have_diagonal = !add_diagonal;
+        for (int i = A.row_offset(row); i < A.row_offset(row + 1); i++) {
+            if (!have_diagonal && A.column(i) >= row) {
+                if (A.column(i) > row) {
+                    entries.push_back(0.);
+                    columns.push_back(row);
+                }
+                have_diagonal = true;
+            }
+            entries.push_back(A.entry(i));
+            columns.push_back(A.column(i));
+        }
+        if (!have_diagonal) {
+            entries.push_back(0.);
+            columns.push_back(row);
+        }
+    }
+    row_offsets[A.rows()] = columns.size();
+}
+
+
+/**************************************************************\
+| JacobiPreconditioner methods
+\**************************************************************/
+JacobiPreconditioner::JacobiPreconditioner (const CRSMatrix &A)
+{
+    std::vector<double> entries;
+    std::vector<int> columns, row_offsets;
+    csr_arrays(A, false, entries, columns, row_offsets);
+
+    inv_diag.resize(A.rows());
+    ispc::jacobi_setup(&entries[0], &columns[0], &row_offsets[0], A.rows(),
+                       &inv_diag[0]);
+}
+
+void JacobiPreconditioner::apply (const Vector &r, Vector &z) const
+{
+    ASSERT(r.size() == inv_diag.size());
+    ASSERT(z.size() == inv_diag.size());
+    ispc::jacobi_apply(&inv_diag[0], &r[0], &z[0], r.size());
+}
+
+
+/**************************************************************\
+| BlockJacobiPreconditioner methods
+\**************************************************************/
+// Must match BLOCK_JACOBI_MAX_SIZE in matrix.ispc
+#define BLOCK_JACOBI_MAX_SIZE 32
+
+BlockJacobiPreconditioner::BlockJacobiPreconditioner (const CRSMatrix &A,
+                                                      int block_size)
+{
+    std::vector<double> entries;
+    std::vector<int> columns, row_offsets;
+    csr_arrays(A, false, entries, columns, row_offsets);
+
+    this->block_size = std::max(1, std::min(block_size, BLOCK_JACOBI_MAX_SIZE));
+    int num_blocks = (A.rows() + this->block_size - 1) / this->block_size;
+    lu.resize((size_t)num_blocks * this->block_size * this->block_size);
+    pivots.resize((size_t)num_blocks * this->block_size);
+    ispc::block_jacobi_setup(&entries[0], &columns[0], &row_offsets[0],
+                             A.rows(), this->block_size, &lu[0], &pivots[0]);
+}
+
+void BlockJacobiPreconditioner::apply (const Vector &r, Vector &z) const
+{
+    ASSERT(r.size() == z.size());
+    ispc::block_jacobi_apply(&lu[0], &pivots[0], r.size(), block_size,
+                             &r[0], &z[0]);
+}
+
+
+/**************************************************************\
+| ILU0Preconditioner methods
+\**************************************************************/
+/* Groups the rows into levels for the L (lower) or U (upper) triangle of
+ * the matrix: a row's level is one more than the highest level of the
+ * rows it depends on.  Returns the rows sorted by level, along with the
+ * offset of each level's first row.
+ */
+static void level_schedule (const std::vector<int> &columns,
+                            const std::vector<int> &row_offsets,
+                            const std::vector<int> &diag, bool lower,
+                            std::vector<int> &level_rows,
+                            std::vector<int> &level_offsets)
+{
+    int rows = row_offsets.size() - 1;
+    std::vector<int> level(rows, 0);
+    int num_levels = 0;
+
+    for (int i = 0; i < rows; i++) {
+        int row = lower ? i : rows - 1 - i;
+        int first = lower ? row_offsets[row] : diag[row] + 1;
+        int end = lower ? diag[row] : row_offsets[row + 1];
+        int l = 0;
+        for (int p = first; p < end; p++)
+            l = std::max(l, level[columns[p]] + 1);
+        level[row] = l;
+        num_levels = std::max(num_levels, l + 1);
+    }
+
+    level_offsets.assign(num_levels + 1, 0);
+    for (int row = 0; row < rows; row++)
+        level_offsets[level[row] + 1]++;
+    for (int l = 0; l < num_levels; l++)
+        level_offsets[l + 1] += level_offsets[l];
+
+    std::vector<int> next(level_offsets.begin(), level_offsets.end() - 1);
+    level_rows.resize(rows);
+    for (int row = 0; row < rows; row++)
+        level_rows[next[level[row]]++] = row;
+}
+
+ILU0Preconditioner::ILU0Preconditioner (const CRSMatrix &A)
+{
+    csr_arrays(A, true, lu, columns, row_offsets);
+
+    diag.resize(A.rows());
+    for (int row = 0; row < A.rows(); row++)
+        for (int p = row_offsets[row]; p < row_offsets[row + 1]; p++)
+            if (columns[p] == row)
+                diag[row] = p;
+
+    level_schedule(columns, row_offsets, diag, true, lower_rows, lower_offsets);
+    level_schedule(columns, row_offsets, diag, false, upper_rows, upper_offsets);
+
+    // The factorization has the same dependencies as the L solve.
+    ispc::ilu0_factor(&lu[0], &columns[0], &row_offsets[0], &diag[0],
+                      &lower_rows[0], &lower_offsets[0], lower_levels());
+}
+
+void ILU0Preconditioner::apply (const Vector &r, Vector &z) const
+{
+    ASSERT(r.size() == diag.size());
+    ASSERT(z.size() == diag.size());
+    ispc::ilu0_apply(&lu[0], &columns[0], &row_offsets[0], &diag[0],
+                     &lower_rows[0], &lower_offsets[0], lower_levels(),
+                     &upper_rows[0], &upper_offsets[0], upper_levels(),
+                     &r[0], &z[0]);
+}
@@ -0,0 +1,107 @@
+/*
+  Copyright (c) 2012-2015, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+
+#ifndef __PRECONDITIONER_H__
+#define __PRECONDITIONER_H__
+
+#include <vector>
+
+#include "matrix.h"
+
+
+/**************************************************************\
+| Preconditioner base class
+\**************************************************************/
+/* A preconditioner M approximates A such that M^-1 is cheap to apply; the
+ * setup work is done by the constructors.
+ */
+class Preconditioner {
+ public:
+    virtual ~Preconditioner() {}
+
+    // z = M^-1 r
+    virtual void apply (const Vector &r, Vector &z) const = 0;
+};
+
+/**************************************************************\
+| Jacobi preconditioner: M = diag(A)
+\**************************************************************/
+class JacobiPreconditioner : public Preconditioner {
+ public:
+    JacobiPreconditioner (const CRSMatrix &A);
+
+    virtual void apply (const Vector &r, Vector &z) const;
+
+ private:
+    std::vector<double> inv_diag;
+};
+
+/**************************************************************\
+| Block-Jacobi preconditioner: M = block diagonal of A
+\**************************************************************/
+class BlockJacobiPreconditioner : public Preconditioner {
+ public:
+    BlockJacobiPreconditioner (const CRSMatrix &A, int block_size = 16);
+
+    virtual void apply (const Vector &r, Vector &z) const;
+
+ private:
+    int                 block_size;
+    std::vector<double> lu;
+    std::vector<int>    pivots;
+};
+
+/**************************************************************\
+| ILU(0) preconditioner: M = LU restricted to the pattern of A
+\**************************************************************/
+class ILU0Preconditioner : public Preconditioner {
+ public:
+    ILU0Preconditioner (const CRSMatrix &A);
+
+    virtual void apply (const Vector &r, Vector &z) const;
+
+    // Number of levels of the level schedules
+    int lower_levels() const { return lower_offsets.size() - 1; }
+    int upper_levels() const { return upper_offsets.size() - 1; }
+
+ private:
+    std::vector<double> lu;
+    std::vector<int>    columns;
+    std::vector<int>    row_offsets;
+    std::vector<int>    diag;
+    std::vector<int>    lower_rows, lower_offsets;
+    std::vector<int>    upper_rows, upper_offsets;
+};
+
+#endif
@@ -0,0 +1,267 @@
+/*
+  Copyright (c) 2010-2014, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#define NOMINMAX
+#pragma warning (disable: 4244)
+#pragma warning (disable: 4305)
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include "../timing.h"
+#include "hash_ispc.h"
+using namespace ispc;
+
+
+extern uint32_t crc32c_serial(uint32_t crc, const void *data, size_t count);
+extern uint32_t xxhash32_serial(const void *data, size_t len, uint32_t seed);
+extern uint64_t xxhash64_serial(const void *data, size_t len, uint64_t seed);
+extern uint32_t murmur3_fmix32_serial(uint32_t h);
+extern uint64_t murmur3_fmix64_serial(uint64_t h);
+
+
+static uint64_t
+random64() {
+    uint64_t r = 0;
+    for (int i = 0; i < 4; ++i)
+        r = (r << 16) ^ (rand() & 0xffff);
+    return r;
+}
+
+
+// Random keys, plus a few that exercise the carries and the high bits.
+static void
+fillKeys(uint64_t *keys64, uint32_t *keys32, int count) {
+    for (int i = 0; i < count; ++i) {
+        keys64[i] = (i == 0) ? 0 : (i == 1) ? ~0ULL : random64();
+        keys32[i] = (uint32_t)keys64[i];
+    }
+}
+
+
+static bool
+report(const char *what, int nErrors, int count) {
+    if (nErrors > 0)
+        printf("Error: %s: %d of %d hashes differ from the reference\n",
+               what, nErrors, count);
+    return nErrors == 0;
+}
+
+
+// Checks that each of the ispc hash functions gives exactly the same
+// results as the reference implementations.
+static bool
+checkHashes() {
+    const int count = 100003;
+    uint64_t *keys64 = new uint64_t[count], *hashes64 = new uint64_t[count];
+    uint32_t *keys32 = new uint32_t[count], *hashes32 = new uint32_t[count];
+    fillKeys(keys64, keys32, count);
+    bool ok = true;
+
+    hash_crc32c(keys32, count, hashes32);
+    int nErrors = 0;
+    for (int i = 0; i < count; ++i)
+        nErrors += (hashes32[i] != crc32c_serial(0, &keys32[i], 4));
+    ok &= report("crc32c", nErrors, count);
+
+    const uint32_t seed32 = 0x2545f491;
+    hash_xxhash32(keys32, count, seed32, hashes32);
+    nErrors = 0;
+    for (int i = 0; i < count; ++i)
+        nErrors += (hashes32[i] != xxhash32_serial(&keys32[i], 4, seed32));
+    ok &= report("xxhash32", nErrors, count);
+
+    const uint64_t seed64 = 0x9e3779b97f4a7c15ULL;
+    hash_xxhash64(keys64, count, seed64, hashes64);
+    nErrors = 0;
+    for (int i = 0; i < count; ++i)
+        nErrors += (hashes64[i] != xxhash64_serial(&keys64[i], 8, seed64));
+    ok &= report("xxhash64", nErrors, count);
+
+    hash_murmur3_fmix32(keys32, count, hashes32);
+    nErrors = 0;
+    for (int i = 0; i < count; ++i)
+        nErrors += (hashes32[i] != murmur3_fmix32_serial(keys32[i]));
+    ok &= report("murmur3_fmix32", nErrors, count);
+
+    hash_murmur3_fmix64(keys64, count, hashes64);
+    nErrors = 0;
+    for (int i = 0; i < count; ++i)
+        nErrors += (hashes64[i] != murmur3_fmix64_serial(keys64[i]));
+    ok &= report("murmur3_fmix64", nErrors, count);
+
+    // Buffers of all lengths up to a few multiples of the 3 KB blocks
+    // that crc32c() processes as three interleaved streams, starting at
+    // every alignment.
+    const int maxLength = 10000;
+    uint8_t *buf = new uint8_t[maxLength + 8];
+    for (int i = 0; i < maxLength + 8; ++i)
+        buf[i] = rand() & 0xff;
+    nErrors = 0;
+    int nBuffers = 0;
+    for (int length = 0; length <= maxLength; length += (length < 100) ? 1 : 97)
+        for (int offset = 0; offset < 8; ++offset, ++nBuffers)
+            nErrors += (crc32c_buffer(buf + offset, length) !=
+                        crc32c_serial(0, buf + offset, length));
+    if (crc32c_buffer((uint8_t *)"123456789", 9) != 0xe3069283)
+        ++nErrors;
+    ok &= report("crc32c of buffers", nErrors, nBuffers + 1);
+
+    delete[] keys64;
+    delete[] hashes64;
+    delete[] keys32;
+    delete[] hashes32;
+    delete[] buf;
+    return ok;
+}
+
+
+static void
+printKeyRate(const char *name, double mcycles, double seconds, int count) {
+    printf("[hash %s]:\t[%.3f] million cycles, %.1f million keys/s\n",
+           name, mcycles, count / seconds * 1e-6);
+}
+
+
+int main(int argc, char *argv[]) {
+    int count = 1 << 22, iterations = 3;
+    for (int a = 1; a < argc; ++a) {
+        if (strncmp(argv[a], "--keys=", 7) == 0)
+            count = atoi(argv[a] + 7);
+        else if (strncmp(argv[a], "--iterations=", 13) == 0)
+            iterations = atoi(argv[a] + 13);
+        else {
+            fprintf(stderr, "usage: hash [--keys=<count>] "
+                    "[--iterations=<count>]\n");
+            return 1;
+        }
+    }
+    if (count < 1 || iterations < 1) {
+        fprintf(stderr, "hash: --keys and --iterations must be positive\n");
+        return 1;
+    }
+
+    bool ok = checkHashes();
+
+    uint64_t *keys64 = new uint64_t[count], *hashes64 = new uint64_t[count];
+    uint32_t *keys32 = new uint32_t[count], *hashes32 = new uint32_t[count];
+    fillKeys(keys64, keys32, count);
+
+    //
+    // Hash count keys with each function, and with the serial versions,
+    // reporting the best of the runs.  The serial results are summed so
+    // that the loops can't be optimized away.
+    //
+#define TIME_KEYS(name, call)                                               \
+    do {                                                                    \
+        double minTime = 1e30, minSec = 1e30;                               \
+        for (int it = 0; it < iterations; ++it) {                           \
+            reset_and_start_timer();                                        \
+            call;                                                           \
+            double dt = get_elapsed_mcycles();                              \
+            minTime = std::min(minTime, dt);                                \
+            minSec = std::min(minSec, get_elapsed_sec());                   \
+        }                                                                   \
+        printKeyRate(name, minTime, minSec, count);                         \
+    } while (0)
+
+    uint64_t sum = 0;
+    printf("Hashing %d keys:\n", count);
+    TIME_KEYS("crc32c ispc", hash_crc32c(keys32, count, hashes32));
+    TIME_KEYS("crc32c serial",
+              for (int i = 0; i < count; ++i)
+                  sum += crc32c_serial(0, &keys32[i], 4));
+    TIME_KEYS("xxhash32 ispc", hash_xxhash32(keys32, count, 0, hashes32));
+    TIME_KEYS("xxhash32 serial",
+              for (int i = 0; i < count; ++i)
+                  sum += xxhash32_serial(&keys32[i], 4, 0));
+    TIME_KEYS("xxhash64 ispc", hash_xxhash64(keys64, count, 0, hashes64));
+    TIME_KEYS("xxhash64 serial",
+              for (int i = 0; i < count; ++i)
+                  sum += xxhash64_serial(&keys64[i], 8, 0));
+    TIME_KEYS("murmur3_fmix32 ispc", hash_murmur3_fmix32(keys32, count, hashes32));
+    TIME_KEYS("murmur3_fmix32 serial",
+              for (int i = 0; i < count; ++i)
+                  sum += murmur3_fmix32_serial(keys32[i]));
+    TIME_KEYS("murmur3_fmix64 ispc", hash_murmur3_fmix64(keys64, count, hashes64));
+    TIME_KEYS("murmur3_fmix64 serial",
+              for (int i = 0; i < count; ++i)
+                  sum += murmur3_fmix64_serial(keys64[i]));
+
+    //
+    // CRC32C of the 64-bit keys as one buffer.
+    //
+    size_t bytes = count * sizeof(uint64_t);
+    uint32_t crcISPC = 0, crcSerial = 0;
+    double minISPC = 1e30, minISPCSec = 1e30;
+    double minSerial = 1e30, minSerialSec = 1e30;
+    for (int it = 0; it < iterations; ++it) {
+        reset_and_start_timer();
+        crcISPC = crc32c_buffer((uint8_t *)keys64, bytes);
+        double dt = get_elapsed_mcycles();
+        minISPC = std::min(minISPC, dt);
+        minISPCSec = std::min(minISPCSec, get_elapsed_sec());
+
+        reset_and_start_timer();
+        crcSerial = crc32c_serial(0, keys64, bytes);
+        dt = get_elapsed_mcycles();
+        minSerial = std::min(minSerial, dt);
+        minSerialSec = std::min(minSerialSec, get_elapsed_sec());
+    }
+    if (crcISPC != crcSerial) {
+        printf("Error: crc32c of %d bytes: ispc 0x%08x, serial 0x%08x\n",
+               (int)bytes, crcISPC, crcSerial);
+        ok = false;
+    }
+    printf("CRC32C of %.1f MB:\n", bytes / (1024. * 1024.));
+    printf("[crc32c buffer ispc]:\t\t[%.3f] million cycles, %.2f GB/s\n",
+           minISPC, bytes / minISPCSec * 1e-9);
+    printf("[crc32c buffer serial]:\t\t[%.3f] million cycles, %.2f GB/s\n",
+           minSerial, bytes / minSerialSec * 1e-9);
+    printf("\t\t\t\t(%.2fx speedup from ISPC)\n", minSerial / minISPC);
+
+    // Keep the serial loops' results live.
+    if (sum == 1)
+        printf("\n");
+
+    delete[] keys64;
+    delete[] hashes64;
+    delete[] keys32;
+    delete[] hashes32;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/*
+  Copyright (c) 2010-2014, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+// Straightforward implementations of the hash functions, following the
+// reference code, for checking the ispc versions and for comparison.
+
+static uint32_t crc32cTable[256];
+
+static void
+initCrc32cTable() {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int j = 0; j < 8; ++j)
+            c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : (c >> 1);
+        crc32cTable[i] = c;
+    }
+}
+
+uint32_t
+crc32c_serial(uint32_t crc, const void *data, size_t count) {
+    if (crc32cTable[1] == 0)
+        initCrc32cTable();
+    const uint8_t *p = (const uint8_t *)data;
+    crc = ~crc;
+    while (count--)
+        crc = (crc >> 8) ^ crc32cTable[(crc ^ *p++) & 0xff];
+    return ~crc;
+}
+
+
+static const uint32_t PRIME32_1 = 0x9e3779b1U, PRIME32_2 = 0x85ebca77U,
+    PRIME32_3 = 0xc2b2ae3dU, PRIME32_4 = 0x27d4eb2fU, PRIME32_5 = 0x165667b1U;
+static const uint64_t PRIME64_1 = 0x9e3779b185ebca87ULL,
+    PRIME64_2 = 0xc2b2ae3d27d4eb4fULL, PRIME64_3 = 0x165667b19e3779f9ULL,
+    PRIME64_4 = 0x85ebca77c2b2ae63ULL, PRIME64_5 = 0x27d4eb2f165667c5ULL;
+
+static inline uint32_t rotl32(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+static inline uint64_t rotl64(uint64_t v, int n) { return (v << n) | (v >> (64 - n)); }
+
+// These read the input with memcpy(), so they assume a little-endian
+// host, as do the ispc versions.
+static inline uint32_t read32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t read64(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+static inline uint32_t
+xxh32Round(uint32_t acc, uint32_t input) {
+    return rotl32(acc + input * PRIME32_2, 13) * PRIME32_1;
+}
+
+uint32_t
+xxhash32_serial(const void *data, size_t len, uint32_t seed) {
+    const uint8_t *p = (const uint8_t *)data, *end = p + len;
+    uint32_t h;
+    if (len >= 16) {
+        uint32_t v1 = seed + PRIME32_1 + PRIME32_2, v2 = seed + PRIME32_2;
+        uint32_t v3 = seed, v4 = seed - PRIME32_1;
+        for (; p + 16 <= end; p += 16) {
+            v1 = xxh32Round(v1, read32(p));
+            v2 = xxh32Round(v2, read32(p + 4));
+            v3 = xxh32Round(v3, read32(p + 8));
+            v4 = xxh32Round(v4, read32(p + 12));
+        }
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    }
+    else
+        h = seed + PRIME32_5;
+    h += (uint32_t)len;
+
+    for (; p + 4 <= end; p += 4)
+        h = rotl32(h + read32(p) * PRIME32_3, 17) * PRIME32_4;
+    for (; p < end; ++p)
+        h = rotl32(h + *p * PRIME32_5, 11) * PRIME32_1;
+
+    h ^= h >> 15;
+    h *= PRIME32_2;
+    h ^= h >> 13;
+    h *= PRIME32_3;
+    return h ^ (h >> 16);
+}
+
+static inline uint64_t
+xxh64Round(uint64_t acc, uint64_t input) {
+    return rotl64(acc + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+static inline uint64_t
+xxh64Merge(uint64_t h, uint64_t v) {
+    return (h ^ xxh64Round(0, v)) * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t
+xxhash64_serial(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)data, *end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2, v2 = seed + PRIME64_2;
+        uint64_t v3 = seed, v4 = seed - PRIME64_1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = xxh64Round(v1, read64(p));
+            v2 = xxh64Round(v2, read64(p + 8));
+            v3 = xxh64Round(v3, read64(p + 16));
+            v4 = xxh64Round(v4, read64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64Merge(h, v1);
+        h = xxh64Merge(h, v2);
+        h = xxh64Merge(h, v3);
+        h = xxh64Merge(h, v4);
+    }
+    else
+        h = seed + PRIME64_5;
+    h += (uint64_t)len;
+
+    for (; p + 8 <= end; p += 8)
+        h = rotl64(h ^ xxh64Round(0, read64(p)), 27) * PRIME64_1 + PRIME64_4;
+    if (p + 4 <= end) {
+        h = rotl64(h ^ (read32(p) * PRIME64_1), 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+        h = rotl64(h ^ (*p * PRIME64_5), 11) * PRIME64_1;
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    return h ^ (h >> 32);
+}
+
+
+uint32_t
+murmur3_fmix32_serial(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    return h ^ (h >> 16);
+}
+
+uint64_t
+murmur3_fmix64_serial(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
@@ -1363,6 +1363,11 @@ static FORCEINLINE int64_t __count_leading_zeros_i64(uint64_t v) {
     return count;
 }
 
+UNARY_OP(__vec64_i32, __count_trailing_zeros_varying_i32, __count_trailing_zeros_i32)
+UNARY_OP(__vec64_i64, __count_trailing_zeros_varying_i64, __count_trailing_zeros_i64)
+UNARY_OP(__vec64_i32, __count_leading_zeros_varying_i32, __count_leading_zeros_i32)
+UNARY_OP(__vec64_i64, __count_leading_zeros_varying_i64, __count_leading_zeros_i64)
+
 ///////////////////////////////////////////////////////////////////////////
 // reductions
 
@@ -2866,6 +2866,34 @@ static FORCEINLINE int64_t __count_leading_zeros_i64(__vec1_i64 mask) {
   return n;
 }
 
+static FORCEINLINE __vec16_i32 __count_trailing_zeros_varying_i32(__vec16_i32 v) {
+    __vec16_i32 ret;
+    for (int i = 0; i < 16; ++i)
+        __insert_element(&ret, i, __count_trailing_zeros_i32(__extract_element(v, i)));
+    return ret;
+}
+
+static FORCEINLINE __vec16_i64 __count_trailing_zeros_varying_i64(__vec16_i64 v) {
+    __vec16_i64 ret;
+    for (int i = 0; i < 16; ++i)
+        __insert_element(&ret, i, __count_trailing_zeros_i64(__extract_element(v, i)));
+    return ret;
+}
+
+static FORCEINLINE __vec16_i32 __count_leading_zeros_varying_i32(__vec16_i32 v) {
+    __vec16_i32 ret;
+    for (int i = 0; i < 16; ++i)
+        __insert_element(&ret, i, __count_leading_zeros_i32(__extract_element(v, i)));
+    return ret;
+}
+
+static FORCEINLINE __vec16_i64 __count_leading_zeros_varying_i64(__vec16_i64 v) {
+    __vec16_i64 ret;
+    for (int i = 0; i < 16; ++i)
+        __insert_element(&ret, i, __count_leading_zeros_i64(__extract_element(v, i)));
+    return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // reductions
 ///////////////////////////////////////////////////////////////////////////
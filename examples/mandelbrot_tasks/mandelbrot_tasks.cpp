@@ -42,6 +42,7 @@
 #include <cstdlib>
 #include <algorithm>
 #include <string.h>
+#include <vector>
 #include "../timing.h"
 #include "mandelbrot_tasks_ispc.h"
 using namespace ispc;
@@ -69,6 +70,113 @@ writePPM(int *buf, int width, int height, const char *fn) {
 }
 
 
+/* Adaptive tiling: tiles start out COARSE_TILE pixels square and are split
+   in halves along x and y, down to MIN_TILE pixels, while their estimated
+   cost is more than 1/TARGET_TILES of the total.  The estimate comes from
+   the iteration counts at every ESTIMATE_STRIDE-th pixel in x and y.
+ */
+#define ESTIMATE_STRIDE 8
+#define COARSE_TILE 128
+#define MIN_TILE 16
+#define TARGET_TILES 512
+
+/* Rows per task in mandelbrot_ispc() */
+#define FIXED_SPAN 4
+
+struct Tile {
+    int x0, y0, x1, y1;
+    double cost;
+};
+
+static bool
+moreExpensive(const Tile &a, const Tile &b) {
+    return a.cost > b.cost;
+}
+
+static double
+estimateCost(const int *estimate, int estWidth, const Tile &t) {
+    double cost = 0;
+    for (int y = t.y0; y < t.y1; y += ESTIMATE_STRIDE)
+        for (int x = t.x0; x < t.x1; x += ESTIMATE_STRIDE)
+            cost += estimate[(y / ESTIMATE_STRIDE) * estWidth + x / ESTIMATE_STRIDE] + 1;
+    return cost;
+}
+
+/* Splits the image into tiles of similar estimated cost and returns their
+   extents in the layout mandelbrot_tiles_ispc() expects, most expensive
+   first. */
+static void
+buildTiles(const int *estimate, int width, int height, std::vector<int> &tiles) {
+    int estWidth = (width + ESTIMATE_STRIDE - 1) / ESTIMATE_STRIDE;
+    std::vector<Tile> work, done;
+    double total = 0;
+    for (int y = 0; y < height; y += COARSE_TILE)
+        for (int x = 0; x < width; x += COARSE_TILE) {
+            Tile t = { x, y, std::min(x + COARSE_TILE, width),
+                       std::min(y + COARSE_TILE, height), 0. };
+            t.cost = estimateCost(estimate, estWidth, t);
+            total += t.cost;
+            work.push_back(t);
+        }
+
+    double target = total / TARGET_TILES;
+    while (!work.empty()) {
+        Tile t = work.back();
+        work.pop_back();
+        int w = t.x1 - t.x0, h = t.y1 - t.y0;
+        bool splitX = w >= 2 * MIN_TILE, splitY = h >= 2 * MIN_TILE;
+        if (t.cost <= target || (!splitX && !splitY)) {
+            done.push_back(t);
+            continue;
+        }
+
+        // Split points stay on multiples of MIN_TILE, so that the tiles'
+        // estimates use the same samples as their parent's.
+        int xm = splitX ? t.x0 + (w / 2 / MIN_TILE) * MIN_TILE : t.x1;
+        int ym = splitY ? t.y0 + (h / 2 / MIN_TILE) * MIN_TILE : t.y1;
+        Tile parts[4] = { { t.x0, t.y0, xm, ym, 0. }, { xm, t.y0, t.x1, ym, 0. },
+                          { t.x0, ym, xm, t.y1, 0. }, { xm, ym, t.x1, t.y1, 0. } };
+        for (int i = 0; i < 4; ++i) {
+            if (parts[i].x0 < parts[i].x1 && parts[i].y0 < parts[i].y1) {
+                parts[i].cost = estimateCost(estimate, estWidth, parts[i]);
+                work.push_back(parts[i]);
+            }
+        }
+    }
+
+    std::sort(done.begin(), done.end(), moreExpensive);
+    tiles.clear();
+    for (size_t i = 0; i < done.size(); ++i) {
+        tiles.push_back(done[i].x0);
+        tiles.push_back(done[i].y0);
+        tiles.push_back(done[i].x1);
+        tiles.push_back(done[i].y1);
+    }
+}
+
+/* Time to run tasks with the given costs, launched in order, on nThreads
+   threads that each take the next task as soon as they're done with the
+   last one, as the task system's queue does. */
+static double
+makespan(const std::vector<double> &costs, int nThreads) {
+    std::vector<double> finish(nThreads, 0.);
+    for (size_t i = 0; i < costs.size(); ++i)
+        *std::min_element(finish.begin(), finish.end()) += costs[i];
+    return *std::max_element(finish.begin(), finish.end());
+}
+
+/* Work of a rectangle of the image: its number of iterations, counting
+   one for each pixel. */
+static double
+regionCost(const int *buf, int width, int x0, int y0, int x1, int y1) {
+    double cost = 0;
+    for (int y = y0; y < y1; ++y)
+        for (int x = x0; x < x1; ++x)
+            cost += buf[y * width + x] + 1;
+    return cost;
+}
+
+
 static void usage() {
     fprintf(stderr, "usage: mandelbrot [--scale=<factor>] [tasks iterations] [serial iterations]\n");
     exit(1);
@@ -124,6 +232,58 @@ int main(int argc, char *argv[]) {
     printf("[mandelbrot ispc+tasks]:\t[%.3f] million cycles\n", minISPC);
     writePPM(buf, width, height, "mandelbrot-ispc.ppm");
 
+    //
+    // Same with adaptive tiles; the time includes the pre-pass and
+    // building the tiles.
+    //
+    int *estimate = new int[((width + ESTIMATE_STRIDE - 1) / ESTIMATE_STRIDE) *
+                            ((height + ESTIMATE_STRIDE - 1) / ESTIMATE_STRIDE)];
+    std::vector<int> tiles;
+    double minAdaptive = 1e30;
+    for (unsigned int i = 0; i < test_iterations[0]; ++i) {
+        for (unsigned int i = 0; i < width * height; ++i)
+            buf[i] = 0;
+        reset_and_start_timer();
+        mandelbrot_estimate_ispc(x0, y0, x1, y1, width, height, ESTIMATE_STRIDE,
+                                 maxIterations, estimate);
+        buildTiles(estimate, width, height, tiles);
+        mandelbrot_tiles_ispc(x0, y0, x1, y1, width, height, &tiles[0],
+                              (int)tiles.size() / 4, maxIterations, buf);
+        double dt = get_elapsed_mcycles();
+        printf("@time of ISPC + adaptive TASKS run:\t\t[%.3f] million cycles\n", dt);
+        minAdaptive = std::min(minAdaptive, dt);
+    }
+
+    printf("[mandelbrot ispc+tasks, adaptive]:\t[%.3f] million cycles (%d tiles)\n",
+           minAdaptive, (int)tiles.size() / 4);
+    writePPM(buf, width, height, "mandelbrot-ispc-adaptive.ppm");
+
+    //
+    // Load balance of the two schedules for 1 to 64 threads, from the
+    // iteration counts of each task's pixels.
+    //
+    std::vector<double> spanCosts, tileCosts;
+    for (unsigned int y = 0; y < height; y += FIXED_SPAN)
+        spanCosts.push_back(regionCost(buf, width, 0, y, width,
+                                       std::min(y + FIXED_SPAN, height)));
+    for (size_t i = 0; i < tiles.size(); i += 4)
+        tileCosts.push_back(regionCost(buf, width, tiles[i], tiles[i+1],
+                                       tiles[i+2], tiles[i+3]));
+    double totalCost = regionCost(buf, width, 0, 0, width, height);
+
+    printf("\nload balance from the iteration counts (speedup, efficiency):\n");
+    printf("threads\t%d row spans\t%d adaptive tiles\n", (int)spanCosts.size(),
+           (int)tileCosts.size());
+    for (int nThreads = 1; nThreads <= 64; nThreads *= 2) {
+        double spanSpeedup = totalCost / makespan(spanCosts, nThreads);
+        double tileSpeedup = totalCost / makespan(tileCosts, nThreads);
+        printf("%d\t%6.2fx %3.0f%%\t%6.2fx %3.0f%%\n", nThreads,
+               spanSpeedup, 100. * spanSpeedup / nThreads,
+               tileSpeedup, 100. * tileSpeedup / nThreads);
+    }
+    printf("\n");
+    delete[] estimate;
+
 
     // 
     // And run the serial implementation 3 times, again reporting the
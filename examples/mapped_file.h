@@ -0,0 +1,358 @@
+/*
+  Copyright (c) 2010-2015, Intel Corporation
+  All rights reserved.
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions are
+  met:
+
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+    * Neither the name of Intel Corporation nor the names of its
+      contributors may be used to endorse or promote products derived from
+      this software without specific prior written permission.
+
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+   IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+   TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+   PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+   OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.  
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+/*
+  Aligned binary input files that are memory-mapped and used in place.
+
+  A mapped file starts with a MappedFileHeader, which gives a magic
+  string, a version and the offset and size of up to
+  MAPPED_FILE_MAX_SECTIONS sections.  Every section starts on a
+  MAPPED_FILE_ALIGNMENT-byte boundary, so once the file is mapped the
+  sections can be handed directly to ispc kernels as arrays.  Like the
+  original input formats, the data is stored in the host's byte order.
+
+  Files converted from another input file also record the size and the
+  modification time of that file, and are rejected once it changes so
+  that the conversion is redone.
+
+  Files are mapped copy-on-write: pages that are only read are shared
+  with the page cache and never copied, while a stray write only affects
+  the process's private copy of that page.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define MAPPED_FILE_ALIGNMENT 4096
+#define MAPPED_FILE_MAX_SECTIONS 16
+
+struct MappedFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nSections;
+    uint64_t offset[MAPPED_FILE_MAX_SECTIONS];
+    uint64_t size[MAPPED_FILE_MAX_SECTIONS];
+    // Size and modification time of the file that the data was converted
+    // from, or zero if there isn't one.
+    uint64_t sourceSize, sourceTime;
+};
+
+
+/* Gets the size and the modification time of the given file.  Returns
+   false if it can't be found. */
+static inline bool
+mappedFileSourceStamp(const char *path, uint64_t &size, uint64_t &time) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes))
+        return false;
+    size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    time = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) |
+        attributes.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+    size = (uint64_t)st.st_size;
+    time = (uint64_t)st.st_mtime;
+#endif
+    return true;
+}
+
+
+class MappedFile {
+public:
+    MappedFile() : base(NULL), length(0), header(NULL) {
+#ifdef _WIN32
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+#endif
+    }
+    ~MappedFile() { close(); }
+
+    /* Maps the given file and checks that it starts with a header with
+       the given magic string and version and that all of its sections are
+       inside the file.  If source is given, the file must also have been
+       converted from the current version of it (if it still exists).
+       Returns false if the file doesn't exist, isn't valid or is out of
+       date. */
+    bool open(const char *path, const char magic[8], uint32_t version,
+              const char *source = NULL) {
+        if (!openRaw(path))
+            return false;
+
+        header = (const MappedFileHeader *)base;
+        bool valid = length >= sizeof(MappedFileHeader) &&
+            memcmp(header->magic, magic, 8) == 0 &&
+            header->version == version &&
+            header->nSections <= MAPPED_FILE_MAX_SECTIONS;
+        for (uint32_t i = 0; valid && i < header->nSections; ++i)
+            valid = (header->offset[i] % MAPPED_FILE_ALIGNMENT) == 0 &&
+                header->offset[i] + header->size[i] <= length;
+        if (!valid) {
+            fprintf(stderr, "%s: not a valid mapped input file\n", path);
+            close();
+            return false;
+        }
+
+        uint64_t sourceSize, sourceTime;
+        if (source != NULL &&
+            mappedFileSourceStamp(source, sourceSize, sourceTime) &&
+            (header->sourceSize != sourceSize ||
+             header->sourceTime != sourceTime)) {
+            fprintf(stderr, "%s: out of date with respect to %s\n", path,
+                    source);
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /* Maps any (non-empty) file as it is, without looking for a header;
+       its contents are then available through data() and size(). */
+    bool openRaw(const char *path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+        mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (mapping != NULL)
+            base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        length = (size_t)st.st_size;
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED)
+            base = NULL;
+        // The mapping stays valid after the descriptor is closed.
+        ::close(fd);
+#endif
+        if (base == NULL) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base != NULL)
+            UnmapViewOfFile(base);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (base != NULL)
+            munmap(base, length);
+#endif
+        base = NULL;
+        length = 0;
+        header = NULL;
+    }
+
+    int numSections() const { return header ? (int)header->nSections : 0; }
+    void *section(int i) const { return (uint8_t *)base + header->offset[i]; }
+    uint64_t sectionSize(int i) const { return header->size[i]; }
+    const void *data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    void *base;
+    size_t length;
+    const MappedFileHeader *header;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+};
+
+
+/* Writes a mapped file one section at a time, so that files that are too
+   large to assemble in memory can be streamed out.  If close() isn't
+   called successfully, the partially written file is removed. */
+class MappedFileWriter {
+public:
+    MappedFileWriter() : f(NULL), sectionStart(0), position(0) { }
+    ~MappedFileWriter() {
+        if (f != NULL) {
+            fclose(f);
+            remove(path);
+        }
+    }
+
+    bool open(const char *fn, const char magic[8], uint32_t version,
+              const char *source = NULL) {
+        f = fopen(fn, "wb");
+        if (f == NULL)
+            return false;
+        strncpy(path, fn, sizeof(path) - 1);
+        path[sizeof(path) - 1] = '\0';
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic, 8);
+        header.version = version;
+        if (source != NULL &&
+            !mappedFileSourceStamp(source, header.sourceSize, header.sourceTime))
+            header.sourceSize = header.sourceTime = 0;
+        // The header is written for real once the sections are known.
+        position = 0;
+        return pad();
+    }
+
+    bool beginSection() {
+        if (header.nSections == MAPPED_FILE_MAX_SECTIONS || !pad())
+            return false;
+        sectionStart = position;
+        return true;
+    }
+
+    bool write(const void *data, uint64_t size) {
+        if (size > 0 && fwrite(data, (size_t)size, 1, f) != 1)
+            return false;
+        position += size;
+        return true;
+    }
+
+    void endSection() {
+        header.offset[header.nSections] = sectionStart;
+        header.size[header.nSections] = position - sectionStart;
+        ++header.nSections;
+    }
+
+    bool close() {
+        bool ok = pad() && fseek(f, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, f) == 1;
+        ok = (fclose(f) == 0) && ok;
+        f = NULL;
+        if (!ok)
+            remove(path);
+        return ok;
+    }
+
+private:
+    // Pads the file with zeros up to the next section boundary, or writes
+    // the (placeholder) header block when the file is empty.
+    bool pad() {
+        static const char zeros[MAPPED_FILE_ALIGNMENT] = { 0 };
+        uint64_t padding = (MAPPED_FILE_ALIGNMENT -
+                            position % MAPPED_FILE_ALIGNMENT) % MAPPED_FILE_ALIGNMENT;
+        if (position == 0)
+            padding = MAPPED_FILE_ALIGNMENT;
+        return write(zeros, padding);
+    }
+
+    FILE *f;
+    char path[1024];
+    MappedFileHeader header;
+    uint64_t sectionStart, position;
+};
+
+
+/* Writes nSections arrays to a new mapped file at the given path, which
+   holds the data converted from the given source file (if any).  Returns
+   false (and removes any partially written file) on failure. */
+static inline bool
+writeMappedFile(const char *path, const char magic[8], uint32_t version,
+                int nSections, const void * const data[],
+                const uint64_t size[], const char *source = NULL) {
+    MappedFileWriter writer;
+    if (!writer.open(path, magic, version, source))
+        return false;
+    for (int i = 0; i < nSections; ++i) {
+        if (!writer.beginSection() || !writer.write(data[i], size[i]))
+            return false;
+        writer.endSection();
+    }
+    return writer.close();
+}
+
+
+/* Returns the peak resident set size of the process so far, in MB. */
+static inline double
+peakRSSMegabytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0.;
+    return counters.PeakWorkingSetSize / (1024. * 1024.);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.;
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024. * 1024.);
+#else
+    return usage.ru_maxrss / 1024.;
+#endif
+#endif
+}
+
+#endif // MAPPED_FILE_H
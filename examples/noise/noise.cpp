@@ -128,5 +128,46 @@ int main(int argc, char *argv[]) {
 
     printf("\t\t\t\t(%.2fx speedup from ISPC)\n", minSerial/minISPC);
 
+    //
+    // Simplex noise fBm and turbulence, in 2D, 3D and 4D, with gradients
+    // from the permutation table and from the integer hash; each sample is
+    // 8 octaves of noise.
+    //
+    const int octaves = 8;
+    printf("\nsimplex noise, %d-wide target, %d octaves:\n",
+           noise_target_width(), octaves);
+    for (int turbulence = 0; turbulence < 2; ++turbulence) {
+        for (int dims = 2; dims <= 4; ++dims) {
+            for (int hashed = 0; hashed < 2; ++hashed) {
+                double minSimplex = 1e30, minSeconds = 1e30;
+                for (unsigned int i = 0; i < test_iterations[0]; ++i) {
+                    reset_and_start_timer();
+                    simplex_ispc_tasks(x0, y0, x1, y1, width, height, dims,
+                                       hashed, turbulence, octaves, 1.99f, 0.6f,
+                                       buf);
+                    double dt = get_elapsed_mcycles();
+                    minSeconds = std::min(minSeconds, get_elapsed_sec());
+                    minSimplex = std::min(minSimplex, dt);
+                }
+                printf("[simplex %dD %s, %s]:\t[%.3f] million cycles "
+                       "(%.1f million samples/s)\n", dims,
+                       turbulence ? "turbulence" : "fBm",
+                       hashed ? "hash" : "perm table", minSimplex,
+                       double(width) * height * octaves / minSeconds * 1e-6);
+
+                if (dims == 3 && hashed) {
+                    if (turbulence)
+                        writePPM(buf, width, height, "noise-simplex-turbulence.ppm");
+                    else {
+                        // fBm is in [-1, 1]
+                        for (unsigned int i = 0; i < width * height; ++i)
+                            buf[i] = 0.5f + 0.5f * buf[i];
+                        writePPM(buf, width, height, "noise-simplex-fbm.ppm");
+                    }
+                }
+            }
+        }
+    }
+
     return 0;
 }
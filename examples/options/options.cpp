@@ -56,12 +56,72 @@ extern void binomial_put_serial(float Sa[], float Xa[], float Ta[],
                                 float result[], int count);
 
 static void usage() {
-    printf("usage: options [--count=<num options>]\n");
+    printf("usage: options [--count=<num options>] [--paths=<num paths>]\n");
+}
+
+
+// Options priced with the Monte Carlo engines: at the money give or take
+// 20%, with one year to expiry.
+#define MC_OPTIONS 64
+#define MC_STEPS 64
+#define MC_SEED 1234
+
+// Engines in the order they're run: the Monte Carlo payoffs, then the
+// Longstaff-Schwartz American put.
+#define MC_AMERICAN_PUT MC_NUM_PAYOFFS
+
+static const char *mcNames[MC_NUM_PAYOFFS + 1] = {
+    "european call", "european put", "asian call", "up-and-out call",
+    "american put (LSM)"
+};
+
+struct McOptions {
+    float S[MC_OPTIONS], X[MC_OPTIONS], T[MC_OPTIONS];
+    float r[MC_OPTIONS], v[MC_OPTIONS], B[MC_OPTIONS];
+};
+
+
+static void mcPrice(McOptions &o, int engine, int nPaths, float result[],
+                    int nTasks) {
+    if (engine == MC_AMERICAN_PUT)
+        american_put_lsm_ispc_tasks(o.S, o.X, o.T, o.r, o.v, MC_STEPS, nPaths,
+                                    MC_SEED, result, MC_OPTIONS, nTasks);
+    else
+        monte_carlo_ispc_tasks(o.S, o.X, o.T, o.r, o.v, o.B, engine, MC_STEPS,
+                               nPaths, MC_SEED, result, MC_OPTIONS, nTasks);
+}
+
+
+// Runs one of the Monte Carlo engines with the default number of tasks
+// and with a single task, checks that both give the same prices bit for
+// bit, and reports the time of the former.  Returns false on a mismatch.
+static bool runMonteCarlo(McOptions &o, int engine, int nPaths, float result[]) {
+    double mcycles = 1e30, seconds = 1e30;
+    for (int i = 0; i < 3; ++i) {
+        reset_and_start_timer();
+        mcPrice(o, engine, nPaths, result, 0);
+        double dt = get_elapsed_mcycles();
+        seconds = std::min(seconds, get_elapsed_sec());
+        mcycles = std::min(mcycles, dt);
+    }
+
+    float check[MC_OPTIONS];
+    mcPrice(o, engine, nPaths, check, 1);
+    bool same = memcmp(result, check, sizeof(check)) == 0;
+
+    double sum = 0.;
+    for (int i = 0; i < MC_OPTIONS; ++i)
+        sum += result[i];
+    printf("[%s ispc, tasks]:\t[%.3f] million cycles (%.0f options/s, avg %f)%s\n",
+           mcNames[engine], mcycles, MC_OPTIONS / seconds, sum / MC_OPTIONS,
+           same ? "" : " -- differs with 1 task!");
+    return same;
 }
 
 
 int main(int argc, char *argv[]) {
     int nOptions = 128*1024;
+    int nPaths = 32*1024;
 
     for (int i = 1; i < argc; ++i) {
         if (strncmp(argv[i], "--count=", 8) == 0) {
@@ -71,6 +131,13 @@ int main(int argc, char *argv[]) {
                 exit(1);
             }
         }
+        else if (strncmp(argv[i], "--paths=", 8) == 0) {
+            nPaths = atoi(argv[i] + 8);
+            if (nPaths <= 0) {
+                usage();
+                exit(1);
+            }
+        }
     }
 
     float *S = new float[nOptions];
@@ -192,5 +259,42 @@ int main(int argc, char *argv[]) {
     printf("\t\t\t\t(%.2fx speedup from ISPC, %.2fx speedup from ISPC + tasks)\n", 
            bs_serial / bs_ispc, bs_serial / bs_ispc_tasks);
 
-    return 0;
+    //
+    // Monte Carlo engines, on a smaller set of options
+    //
+    McOptions mc;
+    for (int i = 0; i < MC_OPTIONS; ++i) {
+        mc.S[i] = 100;
+        mc.X[i] = 80 + 40.f * i / (MC_OPTIONS - 1);
+        mc.T[i] = 1;
+        mc.r[i] = .05f;
+        mc.v[i] = .2f;
+        mc.B[i] = 130;   // barrier of the up-and-out calls
+    }
+    printf("\n%d options, %d paths, %d steps for the path-dependent options\n",
+           MC_OPTIONS, nPaths, MC_STEPS);
+
+    float mcResult[MC_AMERICAN_PUT + 1][MC_OPTIONS];
+    bool ok = true;
+    for (int engine = 0; engine <= MC_AMERICAN_PUT; ++engine)
+        ok &= runMonteCarlo(mc, engine, nPaths, mcResult[engine]);
+
+    // The European prices should converge to Black-Scholes (the puts follow
+    // from the calls by put-call parity), and an American put is worth at
+    // least as much as the European one.
+    float bs[MC_OPTIONS];
+    black_scholes_ispc(mc.S, mc.X, mc.T, mc.r, mc.v, bs, MC_OPTIONS);
+    double callError = 0., putError = 0., premium = 0.;
+    for (int i = 0; i < MC_OPTIONS; ++i) {
+        float put = bs[i] - mc.S[i] + mc.X[i] * expf(-mc.r[i] * mc.T[i]);
+        callError = std::max(callError, (double)fabsf(mcResult[MC_EUROPEAN_CALL][i] - bs[i]));
+        putError = std::max(putError, (double)fabsf(mcResult[MC_EUROPEAN_PUT][i] - put));
+        premium += mcResult[MC_AMERICAN_PUT][i] - mcResult[MC_EUROPEAN_PUT][i];
+    }
+    printf("\t\t\t\t(max difference from black-scholes: %f calls, %f puts)\n",
+           callError, putError);
+    printf("\t\t\t\t(avg early exercise premium of the american puts: %f)\n",
+           premium / MC_OPTIONS);
+
+    return ok ? 0 : 1;
 }
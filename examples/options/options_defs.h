@@ -36,5 +36,16 @@
 
 #define BINOMIAL_NUM 64
 
+// Monte Carlo payoffs
+#define MC_EUROPEAN_CALL   0
+#define MC_EUROPEAN_PUT    1
+#define MC_ASIAN_CALL      2   // arithmetic average over the time steps
+#define MC_UP_AND_OUT_CALL 3   // barrier checked at each time step
+#define MC_NUM_PAYOFFS     4
+
+// Paths are simulated and summed in fixed blocks of this many paths, so
+// that the results don't depend on how the blocks are spread over tasks.
+#define MC_BLOCK_PATHS 4096
+
 
 #endif // OPTIONS_DEFS_H
@@ -38,6 +38,8 @@
 #include <iostream>
 #include <cassert>
 #include <iomanip>
+#include <vector>
+#include <utility>
 #include "timing.h"
 #include "ispc_malloc.h"
 #include "mergeSort_ispc.h"
@@ -67,27 +69,46 @@ static void progressBar(const int x, const int n, const int width = 50)
 }
 
 #include "keyType.h"
-struct Key
-{
-  Key_t key;
-  Val_t val;
-};
 
+/* DUPLICATES has few distinct keys, with each value set to the input
+   position of its key, so that the result shows whether equal keys kept
+   their input order. */
+enum Pattern { SORTED, REVERSE, RANDOM, DUPLICATES, NUM_PATTERNS };
+static const char *patternNames[NUM_PATTERNS] = { "sorted", "reverse", "random", "duplicates" };
 
-int main (int argc, char *argv[])
+static bool lessKey(const std::pair<Key_t,Val_t> &a, const std::pair<Key_t,Val_t> &b)
 {
-  int i, j, n = argc == 1 ? 1024*1024: atoi(argv[1]), m = n < 100 ? 1 : 50, l = n < 100 ? n : RAND_MAX;
-  double tISPC1 = 0.0, tISPC2 = 0.0, tSerial = 0.0;
+  return a.first < b.first;
+}
 
-  Key *keys = new Key[n];
-  srand48(rtc()*65536);
-#pragma omp parallel for
+/* Stable sort of the key/value pairs, for the gold result */
+static void sortGold(const int n, Key_t keys[], Val_t vals[])
+{
+  std::vector< std::pair<Key_t,Val_t> > pairs(n);
+  for (int i = 0; i < n; i++)
+    pairs[i] = std::make_pair(keys[i], vals[i]);
+  std::stable_sort(pairs.begin(), pairs.end(), lessKey);
   for (int i = 0; i < n; i++)
   {
-    keys[i].key = i; //((int)(drand48() * (1<<30)));
-    keys[i].val = i;
+    keys[i] = pairs[i].first;
+    vals[i] = pairs[i].second;
   }
-  std::random_shuffle(keys, keys + n);
+}
+
+/* Returns the number of key/value pairs that differ from the gold result */
+static int checkResult(const int n, const Key_t keysDst[], const Val_t valsDst[],
+                       const Key_t keysGld[], const Val_t valsGld[])
+{
+  int errors = 0;
+  for (int i = 0; i < n; i++)
+    if (keysDst[i] != keysGld[i] || valsDst[i] != valsGld[i])
+      errors++;
+  return errors;
+}
+
+int main (int argc, char *argv[])
+{
+  int i, n = argc == 1 ? 1024*1024: atoi(argv[1]), m = n < 100 ? 1 : (n <= 4*1024*1024 ? 50 : 5);
 
   Key_t *keysSrc = new Key_t[n];
   Val_t *valsSrc = new Val_t[n];
@@ -97,66 +118,87 @@ int main (int argc, char *argv[])
   Val_t *valsDst = new Val_t[n];
   Key_t *keysGld = new Key_t[n];
   Val_t *valsGld = new Val_t[n];
-#pragma omp parallel for
-  for (int i = 0; i < n; i++)
-  {
-    keysSrc[i] = keys[i].key;
-    valsSrc[i] = keys[i].val;
+  int errors = 0;
 
-    keysGld[i] = keysSrc[i];
-    valsGld[i] = valsSrc[i];
-  }
-  delete keys;
+  srand48(rtc()*65536);
 
   ispcSetMallocHeapLimit(1024*1024*1024);
 
   ispc::openMergeSort();
+  const bool sampleSortFits = n <= ispc::mergeSortMaxLength();
 
-  tISPC2 = 1e30;
-  for (i = 0; i < m; i ++)
+  for (int pattern = 0; pattern < NUM_PATTERNS; pattern++)
   {
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+    {
+      const int k = pattern == REVERSE ? n - 1 - i : i;
+      keysGld[i] = k;
+      valsGld[i] = k;
+    }
+    if (pattern == RANDOM)
+    {
+      std::random_shuffle(keysGld, keysGld + n);
+#pragma omp parallel for
+      for (int i = 0; i < n; i++)
+        valsGld[i] = keysGld[i];
+    }
+    else if (pattern == DUPLICATES)
+    {
+      for (int i = 0; i < n; i++)
+        keysGld[i] = static_cast<Key_t>(lrand48() % 16);
+    }
+
+    /* the sorts read the source arrays without modifying them */
     ispcMemcpy(keysSrc, keysGld, n*sizeof(Key_t));
     ispcMemcpy(valsSrc, valsGld, n*sizeof(Val_t));
 
-    reset_and_start_timer();
-    ispc::mergeSort(keysDst, valsDst, keysBuf, valsBuf, keysSrc, valsSrc, n);
-    tISPC2 = std::min(tISPC2, get_elapsed_msec());
-
-    if (argc != 3)
+    /* sample rank based merge (from the CUDA SDK) */
+    double tSample = 1e30;
+    if (sampleSortFits)
+    {
+      for (i = 0; i < m; i ++)
+      {
+        reset_and_start_timer();
+        ispc::mergeSort(keysDst, valsDst, keysBuf, valsBuf, keysSrc, valsSrc, n);
+        tSample = std::min(tSample, get_elapsed_msec());
+
+        if (argc != 3)
+          progressBar (i, m);
+      }
+    }
+    sortGold(n, keysGld, valsGld);
+    if (sampleSortFits)
+    {
+      errors += checkResult(n, keysDst, valsDst, keysGld, valsGld);
+      printf("[sort ispc + tasks, %s]:\t\t[%.3f] msec [%.3f Mpair/s]\n",
+             patternNames[pattern], tSample, 1.0e-3*n/tSample);
+    }
+    else
+      printf("[sort ispc + tasks, %s]:\t\tskipped (more than %d keys)\n",
+             patternNames[pattern], ispc::mergeSortMaxLength());
+
+    /* merge path partitioned levels, bitonic merge networks */
+    double tMergePath = 1e30;
+    for (i = 0; i < m; i ++)
+    {
+      reset_and_start_timer();
+      ispc::mergeSortMergePath(keysDst, valsDst, keysBuf, valsBuf, keysSrc, valsSrc, n);
+      tMergePath = std::min(tMergePath, get_elapsed_msec());
+
+      if (argc != 3)
         progressBar (i, m);
-  }
-
-  ispc::closeMergeSort();
-
-  printf("[sort ispc + tasks]:\t[%.3f] msec [%.3f Mpair/s]\n", tISPC2, 1.0e-3*n/tISPC2);
+    }
+    errors += checkResult(n, keysDst, valsDst, keysGld, valsGld);
 
-#if 0
-  printf("\n---\n");
-  for (int i = 0; i < 128; i++)
-  {
-    if ((i%32) == 0) printf("\n");
-    printf("%d ", (int)keysSrc[i]);
-  }
-  printf("\n---\n");
-  for (int i = 0; i < 128; i++)
-  {
-    if ((i%32) == 0) printf("\n");
-    printf("%d ", (int)keysBuf[i]);
-  }
-  printf("\n---\n");
-  for (int i = 0; i < 128; i++)
-  {
-    if ((i%32) == 0) printf("\n");
-    printf("%d ", (int)keysDst[i]);
+    printf("[sort ispc + tasks, merge path, %s]:\t[%.3f] msec [%.3f Mpair/s]\n",
+           patternNames[pattern], tMergePath, 1.0e-3*n/tMergePath);
   }
-  printf("\n---\n");
-#endif
-
 
+  ispc::closeMergeSort();
 
-  std::sort(keysGld, keysGld + n);
-  for (int i = 0; i < n; i++)
-    assert(keysDst[i] == keysGld[i]);
+  if (errors > 0)
+    printf("ERROR: %d key/value pairs out of place\n", errors);
 
   delete keysSrc;
   delete valsSrc;
@@ -167,5 +209,5 @@ int main (int argc, char *argv[])
   delete keysGld;
   delete valsGld;
 
-  return 0;
+  return errors > 0;
 }
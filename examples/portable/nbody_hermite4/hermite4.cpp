@@ -41,11 +41,13 @@
 #include <algorithm>
 #include <vector>
 #include <cassert>
+#include <string>
 
 #include "timing.h"
 #include "ispc_malloc.h"
 
 #include "typeReal.h"
+#include "octree.h"
 #include "hermite4_ispc.h"
 
 struct Hermite4
@@ -63,7 +65,15 @@ struct Hermite4
   std::vector<real> accx0, accy0, accz0;
   std::vector<real> jrkx0, jrky0, jrkz0;
 
-  Hermite4(const int _n = 8192, const real _eta = 0.1) : n(_n), eta(_eta)
+  /* Barnes-Hut forces if theta > 0, all-pairs forces otherwise */
+  enum {OCTREE_TASKS=64};
+  const real theta;
+  ispc::Octree tree;
+  std::vector<unsigned int> treeKeys;
+  std::vector<int> treeInts;
+  std::vector<real> treeReals;
+
+  Hermite4(const int _n = 8192, const real _eta = 0.1, const real _theta = 0) : n(_n), eta(_eta), theta(_theta)
   {
     eps2  = 4.0/n;  /* eps = 4/n to give Ebin = 1 KT */
     eps2 *= eps2;
@@ -115,6 +125,50 @@ struct Hermite4
       g_velz[i] = vz;
       g_mass[i] = mp;
     }
+
+    if (theta > 0)
+      allocTree(n/2 + 64);
+  }
+
+  /* (re)allocates the tree for n bodies and up to capacity cells */
+  void allocTree(const int capacity)
+  {
+    treeKeys.resize(2*n);
+    treeInts.resize(2*n + OCTREE_TASKS*OCTREE_RADIX + 4*capacity);
+    treeReals.resize(7*n + 6*OCTREE_TASKS + 14*capacity);
+
+    tree.n        = n;
+    tree.nTasks   = OCTREE_TASKS;
+    tree.capacity = capacity;
+    tree.theta    = theta;
+
+    tree.key    = &treeKeys[0];
+    tree.keyTmp = &treeKeys[n];
+
+    int *ip = &treeInts[0];
+    tree.perm      = ip;  ip += n;
+    tree.permTmp   = ip;  ip += n;
+    tree.histogram = ip;  ip += OCTREE_TASKS*OCTREE_RADIX;
+    tree.begin     = ip;  ip += capacity;
+    tree.end       = ip;  ip += capacity;
+    tree.child     = ip;  ip += capacity;
+    tree.nChild    = ip;
+
+    real *rp = &treeReals[0];
+    real **bodies[] = {&tree.mass, &tree.posx, &tree.posy, &tree.posz, &tree.velx, &tree.vely, &tree.velz};
+    for (int k = 0; k < 7; k++, rp += n)
+      *bodies[k] = rp;
+    tree.bounds = rp;  rp += 6*OCTREE_TASKS;
+    real **cells[] = {&tree.cmass, &tree.comx, &tree.comy, &tree.comz, &tree.comvx, &tree.comvy, &tree.comvz,
+                      &tree.qxx, &tree.qyy, &tree.qzz, &tree.qxy, &tree.qxz, &tree.qyz, &tree.open2};
+    for (int k = 0; k < 14; k++, rp += capacity)
+      *cells[k] = rp;
+  }
+
+  void buildTree()
+  {
+    while (!ispc::octree_build(&tree, g_mass, g_posx, g_posy, g_posz, g_velx, g_vely, g_velz))
+      allocTree(2*tree.capacity);
   }
 
   ~Hermite4()
@@ -136,6 +190,8 @@ struct Hermite4
   }
 
   void forces();
+  void directForces();
+  void treeForces();
 
   real step(const real dt)
   {
@@ -257,8 +313,12 @@ struct Hermite4
     const double tin = rtc();
     forces();
     const double fn = n;
-    printf(" mean flop rate in %g sec [%g GFLOP/s]\n", rtc() - tin,
-        fn*fn*PP_FLOP/(rtc() - tin)/1e9);
+    if (theta > 0)
+      printf(" tree forces in %g sec [%d cells, %d levels]\n", rtc() - tin,
+          tree.nCells, tree.nLevels);
+    else
+      printf(" mean flop rate in %g sec [%g GFLOP/s]\n", rtc() - tin,
+          fn*fn*PP_FLOP/(rtc() - tin)/1e9);
 
     real Epot0, Ekin0;
     energy(Ekin0, Epot0);
@@ -295,8 +355,11 @@ struct Hermite4
       }
 
       if (iter % ntime == 0) {
-        printf(" mean flop rate in %g sec [%g GFLOP/s]\n", rtc() - t0,
-            fn*fn*PP_FLOP/(rtc() - t0)/1e9*ntime);
+        if (theta > 0)
+          printf(" mean step time %g sec\n", (rtc() - t0)/ntime);
+        else
+          printf(" mean flop rate in %g sec [%g GFLOP/s]\n", rtc() - t0,
+              fn*fn*PP_FLOP/(rtc() - t0)/1e9*ntime);
       }
 
       fflush(stdout);
@@ -309,6 +372,14 @@ struct Hermite4
 
 
 void Hermite4::forces()
+{
+  if (theta > 0)
+    treeForces();
+  else
+    directForces();
+}
+
+void Hermite4::directForces()
 {
   ispc::compute_forces(
       n,
@@ -329,15 +400,87 @@ void Hermite4::forces()
       eps2);
 }
 
-void run(const int nbodies, const real eta, const int nstep)
+void Hermite4::treeForces()
+{
+  buildTree();
+  ispc::octree_forces(
+      &tree,
+      g_accx,
+      g_accy,
+      g_accz,
+      g_jrkx,
+      g_jrky,
+      g_jrkz,
+      g_gpot,
+      eps2);
+}
+
+/* Times the tree build and the Barnes-Hut forces for 10^4 ... maxN
+ * bodies; up to 10^5 bodies the accelerations are compared with the
+ * all-pairs ones as well. */
+void bench(const int maxN, const real theta)
 {
-  Hermite4 h4(nbodies, eta);
+  printf(" theta= %g \n", theta);
+  for (int n = 10000; n <= maxN; n *= 10)
+  {
+    Hermite4 h4(n, 0.1, theta);
+
+    double tbuild = HUGE, tforce = HUGE;
+    for (int k = 0; k < 3; k++)
+    {
+      const double t0 = rtc();
+      h4.buildTree();
+      const double t1 = rtc();
+      ispc::octree_forces(&h4.tree, h4.g_accx, h4.g_accy, h4.g_accz,
+          h4.g_jrkx, h4.g_jrky, h4.g_jrkz, h4.g_gpot, h4.eps2);
+      tbuild = std::min(tbuild, t1 - t0);
+      tforce = std::min(tforce, rtc() - t1);
+    }
+    printf("n= %d: build %g sec, forces %g sec [%g Mbodies/s] %d cells, %d levels",
+        n, tbuild, tforce, n/(tbuild + tforce)/1e6, h4.tree.nCells, h4.tree.nLevels);
+
+    if (n <= 100000)
+    {
+      const std::vector<real> ax(h4.g_accx, h4.g_accx + n);
+      const std::vector<real> ay(h4.g_accy, h4.g_accy + n);
+      const std::vector<real> az(h4.g_accz, h4.g_accz + n);
+      h4.directForces();
+      double err2 = 0;
+      for (int i = 0; i < n; i++)
+      {
+        const double dx = ax[i] - h4.g_accx[i];
+        const double dy = ay[i] - h4.g_accy[i];
+        const double dz = az[i] - h4.g_accz[i];
+        const double a2 = h4.g_accx[i]*h4.g_accx[i] + h4.g_accy[i]*h4.g_accy[i] + h4.g_accz[i]*h4.g_accz[i];
+        err2 += (dx*dx + dy*dy + dz*dz)/a2;
+      }
+      printf(", rms rel. acc. error %g", std::sqrt(err2/n));
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+}
+
+void run(const int nbodies, const real eta, const int nstep, const real theta)
+{
+  Hermite4 h4(nbodies, eta, theta);
   h4.integrate(nstep);
 }
 
 int main(int argc, char *argv[])
 {
-  printf("  Usage: %s [nbodies=8192] [nsteps=40] [eta=0.1] \n", argv[0]);
+  printf("  Usage: %s [nbodies=8192] [nsteps=40] [eta=0.1] [theta=0] \n", argv[0]);
+  printf("         %s bench [maxN=1000000] [theta=0.5] \n", argv[0]);
+
+  if (argc > 1 && std::string(argv[1]) == "bench")
+  {
+    int maxN = 1000000;
+    if (argc > 2) maxN = atoi(argv[2]);
+    float theta = 0.5;
+    if (argc > 3) theta = atof(argv[3]);
+    bench(maxN, theta);
+    return 0;
+  }
 
   int nbodies = 8192;
   if (argc > 1) nbodies = atoi(argv[1]);
@@ -348,14 +491,15 @@ int main(int argc, char *argv[])
   float eta = 0.1;
   if (argc > 3) eta = atof(argv[3]);
 
-
+  float theta = 0;
+  if (argc > 4) theta = atof(argv[4]);
 
   printf("nbodies= %d\n", nbodies);
   printf("nstep= %d\n", nstep);
   printf(" eta= %g \n", eta);
+  printf(" theta= %g \n", theta);
 
-  run(nbodies, eta, nstep);
+  run(nbodies, eta, nstep, theta);
 
   return 0;
 }
-
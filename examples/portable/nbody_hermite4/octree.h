@@ -0,0 +1,6 @@
+#pragma once
+
+/* Barnes-Hut octree parameters, shared by hermite4.ispc and hermite4.cpp */
+#define OCTREE_MAX_LEVEL 10    /* 3*10-bit Morton keys */
+#define OCTREE_LEAF      16    /* cells with more bodies are split */
+#define OCTREE_RADIX     256   /* digits per pass of the Morton sort */
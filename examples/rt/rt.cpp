@@ -41,10 +41,14 @@
 #include <stdio.h>
 #include <math.h>
 #include <algorithm>
+#include <vector>
 #include <assert.h>
 #include <string.h>
 #include <sys/types.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include "../timing.h"
+#include "../mapped_file.h"
 #include "rt_ispc.h"
 
 using namespace ispc;
@@ -96,72 +100,512 @@ static void writeImage(int *idImage, float *depthImage, int width, int height,
 
 
 static void usage() {
-    fprintf(stderr, "rt <scene name base> [--scale=<factor>] [ispc iterations] [tasks iterations] [serial iterations]\n");
+    fprintf(stderr, "rt <scene name base> [--scale=<factor>] [--stream=<num rays>] [--wide=<num rays>] [--build] [ispc iterations] [tasks iterations] [serial iterations]\n");
     exit(1);
 }
 
 
-int main(int argc, char *argv[]) {
-    static unsigned int test_iterations[] = {3, 7, 1};
-    float scale = 1.f;
-    const char *filename = NULL;
-    if (argc < 2) usage();
-    filename = argv[1];
-    if (argc > 2) {
-        if (strncmp(argv[2], "--scale=", 8) == 0) {
-            scale = atof(argv[2] + 8);
-        }
+// Small xorshift generator so that the random ray set is the same on all
+// platforms.
+static inline float randomFloat(unsigned int &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return (state & 0xffffff) / float(1 << 24);
+}
+
+
+// Allocates the SoA arrays of a RayStream holding nRays rays.
+static void allocStream(RayStream &rays, int nRays) {
+    rays.ox = new float[nRays];
+    rays.oy = new float[nRays];
+    rays.oz = new float[nRays];
+    rays.dx = new float[nRays];
+    rays.dy = new float[nRays];
+    rays.dz = new float[nRays];
+    rays.maxt = new float[nRays];
+    rays.hitId = new int[nRays];
+}
+
+
+static void freeStream(RayStream &rays) {
+    delete[] rays.ox; delete[] rays.oy; delete[] rays.oz;
+    delete[] rays.dx; delete[] rays.dy; delete[] rays.dz;
+    delete[] rays.maxt; delete[] rays.hitId;
+}
+
+
+static void resetStream(RayStream &rays, int nRays) {
+    for (int i = 0; i < nRays; ++i) {
+        rays.maxt[i] = 1e30f;
+        rays.hitId[i] = 0;
     }
-    if ((argc == 6) || (argc == 5)) {
-        for (int i = 0; i < 3; i++) {
-            test_iterations[i] = atoi(argv[argc - 3 + i]);
+}
+
+
+// Fills the stream with rays whose origins are uniformly distributed
+// inside the given bounds and whose directions are uniformly distributed
+// over the sphere.
+static void generateRandomRays(RayStream &rays, int nRays,
+                               const float bounds[2][3]) {
+    unsigned int state = 0x12345678;
+    for (int i = 0; i < nRays; ++i) {
+        rays.ox[i] = bounds[0][0] + randomFloat(state) * (bounds[1][0] - bounds[0][0]);
+        rays.oy[i] = bounds[0][1] + randomFloat(state) * (bounds[1][1] - bounds[0][1]);
+        rays.oz[i] = bounds[0][2] + randomFloat(state) * (bounds[1][2] - bounds[0][2]);
+        float z = 1.f - 2.f * randomFloat(state);
+        float r = sqrtf(std::max(0.f, 1.f - z*z));
+        float phi = 2.f * 3.14159265358979f * randomFloat(state);
+        rays.dx[i] = r * cosf(phi);
+        rays.dy[i] = r * sinf(phi);
+        rays.dz[i] = z;
+    }
+}
+
+
+// Sorts the rays of the stream by octant and origin cell and copies them
+// into sorted in that order, with the hit information reset; perm[i] is
+// set to the index in rays of sorted ray i.  The sorted stream is split
+// into single-octant segments of at most STREAM_SEGMENT_SIZE rays, and
+// the number of segments is returned.
+#define STREAM_SEGMENT_SIZE 4096
+
+static int sortStream(RayStream &rays, int nRays, const float bounds[2][3],
+                      RayStream &sorted, unsigned int keys[],
+                      uint64_t order[], int perm[], int segmentStart[],
+                      int segmentCount[]) {
+    stream_sort_keys(&rays, nRays, bounds, keys);
+    for (int i = 0; i < nRays; ++i)
+        order[i] = ((uint64_t)keys[i] << 32) | (uint32_t)i;
+    std::sort(order, order + nRays);
+
+    int nSegments = 0;
+    unsigned int lastOctant = ~0u;
+    for (int i = 0; i < nRays; ++i) {
+        int src = (int)(order[i] & 0xffffffff);
+        perm[i] = src;
+        sorted.ox[i] = rays.ox[src];
+        sorted.oy[i] = rays.oy[src];
+        sorted.oz[i] = rays.oz[src];
+        sorted.dx[i] = rays.dx[src];
+        sorted.dy[i] = rays.dy[src];
+        sorted.dz[i] = rays.dz[src];
+        sorted.maxt[i] = 1e30f;
+        sorted.hitId[i] = 0;
+
+        unsigned int octant = (unsigned int)(order[i] >> (32 + 27));
+        if (octant != lastOctant ||
+            segmentCount[nSegments-1] == STREAM_SEGMENT_SIZE) {
+            segmentStart[nSegments] = i;
+            segmentCount[nSegments++] = 0;
+            lastOctant = octant;
         }
+        ++segmentCount[nSegments-1];
     }
+    return nSegments;
+}
 
-#define READ(var, n)                                            \
-    if (fread(&(var), sizeof(var), n, f) != (unsigned int)n) {  \
-        fprintf(stderr, "Unexpected EOF reading scene file\n"); \
-        return 1;                                               \
-    } else /* eat ; */                                                     
+
+// Returns the number of rays whose stream and packet results differ.
+static int countStreamMismatches(const RayStream &sorted, const int perm[],
+                                 const int packetHits[], int nRays) {
+    int mismatches = 0;
+    for (int i = 0; i < nRays; ++i)
+        if (sorted.hitId[i] != packetHits[perm[i]])
+            ++mismatches;
+    return mismatches;
+}
+
+
+// Traces nRays incoherent rays, with origins uniformly distributed inside
+// the scene bounds and uniformly distributed directions, both with the
+// packet traversal and with the sorted stream traversal.
+static void streamBenchmark(int nRays, int iterations,
+                            const LinearBVHNode nodes[],
+                            const Triangle triangles[]) {
+    RayStream rays;
+    allocStream(rays, nRays);
+    generateRandomRays(rays, nRays, nodes[0].bounds);
 
     //
-    // Read the camera specification information from the camera file
+    // Packet traversal of the rays in generation order
     //
-    char fnbuf[1024];
-    sprintf(fnbuf, "%s.camera", filename);
-    FILE *f = fopen(fnbuf, "rb");
-    if (!f) {
-        perror(fnbuf);
-        return 1;
+    double minTimePacket = 1e30, minSecPacket = 1e30;
+    int64_t packetVisits = 0;
+    for (int i = 0; i < iterations; ++i) {
+        resetStream(rays, nRays);
+        reset_and_start_timer();
+        trace_packet_ispc_tasks(&rays, nRays, nodes, triangles, &packetVisits);
+        double dt = get_elapsed_mcycles();
+        minTimePacket = std::min(dt, minTimePacket);
+        minSecPacket = std::min(get_elapsed_sec(), minSecPacket);
     }
+    int *packetHits = new int[nRays];
+    memcpy(packetHits, rays.hitId, nRays * sizeof(int));
+    printf("[rt packet, random rays]:\t[%.3f] million cycles, %.2f Mrays/s\n",
+           minTimePacket, nRays / minSecPacket * 1e-6);
 
     //
-    // Nothing fancy, and trouble if we run on a big-endian system, just
-    // fread in the bits
+    // Stream traversal: sort the rays by octant and origin cell, reorder
+    // the stream, then split it into single-octant segments.  The sort is
+    // timed along with the traversal.
     //
-    int baseWidth, baseHeight;
-    float camera2world[4][4], raster2camera[4][4];
-    READ(baseWidth, 1);
-    READ(baseHeight, 1);
-    READ(camera2world[0][0], 16);
-    READ(raster2camera[0][0], 16);
+    RayStream sorted;
+    allocStream(sorted, nRays);
+    unsigned int *keys = new unsigned int[nRays];
+    uint64_t *order = new uint64_t[nRays];
+    int *perm = new int[nRays];
+    int maxSegments = nRays / STREAM_SEGMENT_SIZE + 9;
+    int *segmentStart = new int[maxSegments];
+    int *segmentCount = new int[maxSegments];
+
+    double minTimeStream = 1e30, minSecStream = 1e30;
+    for (int iter = 0; iter < iterations; ++iter) {
+        reset_and_start_timer();
+        int nSegments = sortStream(rays, nRays, nodes[0].bounds, sorted, keys,
+                                   order, perm, segmentStart, segmentCount);
+        trace_stream_ispc_tasks(&sorted, segmentStart, segmentCount,
+                                nSegments, nodes, triangles);
+        double dt = get_elapsed_mcycles();
+        minTimeStream = std::min(dt, minTimeStream);
+        minSecStream = std::min(get_elapsed_sec(), minSecStream);
+    }
+    printf("[rt stream, random rays]:\t[%.3f] million cycles, %.2f Mrays/s\n",
+           minTimeStream, nRays / minSecStream * 1e-6);
+    printf("\t\t\t\t(%.2fx speedup from stream tracing)\n",
+           minTimePacket / minTimeStream);
+
+    // Both paths find the closest hit, so they should only disagree on
+    // the rare ray that hits two triangles at exactly the same distance.
+    int mismatches = countStreamMismatches(sorted, perm, packetHits, nRays);
+    if (mismatches > 0)
+        printf("%d of %d rays differ between packet and stream tracing\n",
+               mismatches, nRays);
+
+    delete[] packetHits;
+    delete[] keys;
+    delete[] order;
+    delete[] perm;
+    delete[] segmentStart;
+    delete[] segmentCount;
+    freeStream(sorted);
+    freeStream(rays);
+}
 
-    //
-    // Read in the serialized BVH 
-    //
-    sprintf(fnbuf, "%s.bvh", filename);
-    f = fopen(fnbuf, "rb");
+
+// Checks the stream traversal against the packet traversal on a
+// synthetic scene whose BVH is deeper than the stream traversal's stack
+// of index lists.  The BVH is a chain: interior node 2*i has the leaf
+// holding triangle i as its first child and interior node 2*i+2 as its
+// second one, with the last triangle in the leaf at the end of the chain.
+// Triangle i faces the -x axis at x = i+1 and covers y in [i, i+1]; the
+// rays all travel along +x at a y that only hits one of the triangles, so
+// that they have to go down the chain to that triangle's depth.  (Since
+// the rays visit each node's leaf child first, the packet traversal's
+// stack stays small.)
+static bool deepStreamCheck() {
+    const int depth = 160;
+    const int nTris = depth + 1;
+    std::vector<Triangle> tris(nTris);
+    for (int i = 0; i < nTris; ++i) {
+        float p[3][3] = { { i + 1.f, (float)i,   -1.f },
+                          { i + 1.f, i + 1.f,    -1.f },
+                          { i + 1.f, i + 0.5f,    1.f } };
+        memset(&tris[i], 0, sizeof(Triangle));
+        for (int v = 0; v < 3; ++v)
+            for (int a = 0; a < 3; ++a)
+                tris[i].p[v][a] = p[v][a];
+        tris[i].id = i + 1;
+    }
+
+    std::vector<LinearBVHNode> nodes(2 * depth + 1);
+    for (int i = 0; i <= depth; ++i) {
+        // Leaf for triangle i; the last one terminates the chain.
+        LinearBVHNode &leaf = nodes[i < depth ? 2 * i + 1 : 2 * depth];
+        memset(&leaf, 0, sizeof(LinearBVHNode));
+        leaf.bounds[0][0] = leaf.bounds[1][0] = i + 1.f;
+        leaf.bounds[0][1] = (float)i;
+        leaf.bounds[1][1] = i + 1.f;
+        leaf.bounds[0][2] = -1.f;
+        leaf.bounds[1][2] = 1.f;
+        leaf.offset = i;
+        leaf.nPrimitives = 1;
+    }
+    for (int i = depth - 1; i >= 0; --i) {
+        LinearBVHNode &node = nodes[2 * i];
+        memset(&node, 0, sizeof(LinearBVHNode));
+        const LinearBVHNode &first = nodes[2 * i + 1];
+        const LinearBVHNode &second = nodes[2 * i + 2];
+        for (int a = 0; a < 3; ++a) {
+            node.bounds[0][a] = std::min(first.bounds[0][a], second.bounds[0][a]);
+            node.bounds[1][a] = std::max(first.bounds[1][a], second.bounds[1][a]);
+        }
+        node.offset = 2 * i + 2;
+        node.splitAxis = 0;
+    }
+
+    const int nRays = 16 * nTris;
+    RayStream rays, sorted;
+    allocStream(rays, nRays);
+    allocStream(sorted, nRays);
+    unsigned int state = 0x9e3779b9;
+    for (int i = 0; i < nRays; ++i) {
+        int target = i % nTris;
+        rays.ox[i] = 0.f;
+        rays.oy[i] = target + 0.5f + 0.2f * (randomFloat(state) - 0.5f);
+        rays.oz[i] = 0.4f * (randomFloat(state) - 0.5f);
+        rays.dx[i] = 1.f;
+        rays.dy[i] = 1e-4f;
+        rays.dz[i] = 1e-4f;
+    }
+
+    resetStream(rays, nRays);
+    int64_t packetVisits = 0;
+    trace_packet_ispc_tasks(&rays, nRays, &nodes[0], &tris[0], &packetVisits);
+    int *packetHits = new int[nRays];
+    memcpy(packetHits, rays.hitId, nRays * sizeof(int));
+
+    unsigned int *keys = new unsigned int[nRays];
+    uint64_t *order = new uint64_t[nRays];
+    int *perm = new int[nRays];
+    int maxSegments = nRays / STREAM_SEGMENT_SIZE + 9;
+    int *segmentStart = new int[maxSegments];
+    int *segmentCount = new int[maxSegments];
+    int nSegments = sortStream(rays, nRays, nodes[0].bounds, sorted, keys,
+                               order, perm, segmentStart, segmentCount);
+    trace_stream_ispc_tasks(&sorted, segmentStart, segmentCount, nSegments,
+                            &nodes[0], &tris[0]);
+
+    int mismatches = countStreamMismatches(sorted, perm, packetHits, nRays);
+    int misses = 0;
+    for (int i = 0; i < nRays; ++i)
+        if (packetHits[i] != i % nTris + 1)
+            ++misses;
+    if (mismatches > 0 || misses > 0)
+        printf("Deep BVH check FAILED: %d of %d rays differ between packet "
+               "and stream tracing, %d packet rays missed their triangle\n",
+               mismatches, nRays, misses);
+    else
+        printf("Deep BVH check passed: stream and packet tracing agree on "
+               "%d rays through a depth %d BVH\n", nRays, depth);
+
+    delete[] packetHits;
+    delete[] keys;
+    delete[] order;
+    delete[] perm;
+    delete[] segmentStart;
+    delete[] segmentCount;
+    freeStream(sorted);
+    freeStream(rays);
+    return mismatches == 0 && misses == 0;
+}
+
+
+static inline float surfaceArea(const float b[2][3]) {
+    float dx = b[1][0] - b[0][0], dy = b[1][1] - b[0][1], dz = b[1][2] - b[0][2];
+    return 2.f * (dx*dy + dy*dz + dz*dx);
+}
+
+
+// Converts the subtree of the binary BVH rooted at nodeNum into wide BVH
+// nodes of at most the given width and returns the index of its root.
+// Interior nodes are collapsed into their parent, largest surface area
+// first, until the parent is full or only leaves are left.
+static unsigned int collapseBVH(const LinearBVHNode nodes[], uint nodeNum,
+                                int width, std::vector<WideBVHNode> &wide) {
+    uint children[sizeof(wide[0].child) / sizeof(wide[0].child[0])];
+    int nChildren = 0;
+    if (nodes[nodeNum].nPrimitives > 0)
+        children[nChildren++] = nodeNum;
+    else {
+        children[nChildren++] = nodeNum + 1;
+        children[nChildren++] = nodes[nodeNum].offset;
+    }
+
+    while (nChildren < width) {
+        int best = -1;
+        for (int i = 0; i < nChildren; ++i) {
+            const LinearBVHNode &n = nodes[children[i]];
+            if (n.nPrimitives == 0 &&
+                (best == -1 ||
+                 surfaceArea(n.bounds) > surfaceArea(nodes[children[best]].bounds)))
+                best = i;
+        }
+        if (best == -1)
+            break;
+        uint expand = children[best];
+        children[best] = expand + 1;
+        children[nChildren++] = nodes[expand].offset;
+    }
+
+    unsigned int index = (unsigned int)wide.size();
+    wide.push_back(WideBVHNode());
+    WideBVHNode node;
+    memset(&node, 0, sizeof(node));
+    node.nChildren = nChildren;
+    for (int i = 0; i < nChildren; ++i) {
+        const LinearBVHNode &n = nodes[children[i]];
+        for (int a = 0; a < 3; ++a) {
+            node.bounds[0][a][i] = n.bounds[0][a];
+            node.bounds[1][a][i] = n.bounds[1][a];
+        }
+        if (n.nPrimitives > 0) {
+            node.child[i] = n.offset;
+            node.nPrimitives[i] = n.nPrimitives;
+        }
+        else
+            // The recursive call may grow (and reallocate) the vector, so
+            // the node is only stored once all children are done.
+            node.child[i] = collapseBVH(nodes, children[i], width, wide);
+    }
+    wide[index] = node;
+    return index;
+}
+
+
+// Compares the binary BVH packet traversal with 4- and 8-wide BVHs, both
+// with one ray per program instance and with a single ray spread across
+// the program instances, on the same random rays.
+static void wideBenchmark(int nRays, int iterations,
+                          const LinearBVHNode nodes[], uint nNodes,
+                          const Triangle triangles[]) {
+    RayStream rays;
+    allocStream(rays, nRays);
+    generateRandomRays(rays, nRays, nodes[0].bounds);
+
+    double minTimeBinary = 1e30, minSecBinary = 1e30;
+    int64_t binaryVisits = 0;
+    for (int i = 0; i < iterations; ++i) {
+        resetStream(rays, nRays);
+        reset_and_start_timer();
+        trace_packet_ispc_tasks(&rays, nRays, nodes, triangles, &binaryVisits);
+        double dt = get_elapsed_mcycles();
+        minTimeBinary = std::min(dt, minTimeBinary);
+        minSecBinary = std::min(get_elapsed_sec(), minSecBinary);
+    }
+    printf("[rt BVH2, ray per lane]:\t[%.3f] million cycles, %.2f Mrays/s, "
+           "%u nodes, %.2f node visits per ray\n", minTimeBinary,
+           nRays / minSecBinary * 1e-6, nNodes, double(binaryVisits) / nRays);
+
+    for (int width = 4; width <= 8; width *= 2) {
+        std::vector<WideBVHNode> wide;
+        collapseBVH(nodes, 0, width, wide);
+
+        for (int single = 0; single < 2; ++single) {
+            double minTime = 1e30, minSec = 1e30;
+            int64_t visits = 0;
+            for (int i = 0; i < iterations; ++i) {
+                resetStream(rays, nRays);
+                reset_and_start_timer();
+                if (single)
+                    trace_wide_single_ispc_tasks(&rays, nRays, &wide[0],
+                                                 triangles, &visits);
+                else
+                    trace_wide_ispc_tasks(&rays, nRays, &wide[0], triangles,
+                                          &visits);
+                double dt = get_elapsed_mcycles();
+                minTime = std::min(dt, minTime);
+                minSec = std::min(get_elapsed_sec(), minSec);
+            }
+            printf("[rt BVH%d, %s]:\t[%.3f] million cycles, %.2f Mrays/s, "
+                   "%d nodes, %.2f node visits per ray\n", width,
+                   single ? "ray across lanes" : "ray per lane", minTime,
+                   nRays / minSec * 1e-6, (int)wide.size(),
+                   double(visits) / nRays);
+        }
+    }
+
+    freeStream(rays);
+}
+
+
+// Rebuilds the BVH from the scene's triangles with the ispc binned SAH
+// builder, reports the build throughput and then renders the scene with
+// the new BVH.  Returns false if any pixel's hit distance differs from the
+// render with the BVH loaded from the .bvh file (loadedNodes); the hit
+// triangle may only differ where two triangles are hit at the same
+// distance.
+static bool buildBenchmark(int iterations, const LinearBVHNode loadedNodes[],
+                           const Triangle triangles[],
+                           uint nTris, int width, int height,
+                           int baseWidth, int baseHeight,
+                           const float raster2camera[4][4],
+                           const float camera2world[4][4],
+                           float image[], int id[]) {
+    LinearBVHNode *nodes = new LinearBVHNode[2 * nTris];
+    Triangle *sortedTris = new Triangle[nTris];
+    int nNodes = 0;
+
+    double minTimeBuild = 1e30, minSecBuild = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        reset_and_start_timer();
+        nNodes = build_bvh_ispc(triangles, nTris, nodes, sortedTris);
+        double dt = get_elapsed_mcycles();
+        minTimeBuild = std::min(dt, minTimeBuild);
+        minSecBuild = std::min(get_elapsed_sec(), minSecBuild);
+    }
+    printf("[rt ispc SAH build]:\t\t[%.3f] million cycles, %.2f million "
+           "triangles/s, %d nodes\n", minTimeBuild,
+           nTris / minSecBuild * 1e-6, nNodes);
+
+    double minTimeRender = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        reset_and_start_timer();
+        raytrace_ispc_tasks(width, height, baseWidth, baseHeight, raster2camera,
+                            camera2world, image, id, nodes, sortedTris);
+        double dt = get_elapsed_mcycles();
+        minTimeRender = std::min(dt, minTimeRender);
+    }
+    printf("[rt ispc + tasks, built BVH]:\t[%.3f] million cycles for %d x %d image\n",
+           minTimeRender, width, height);
+
+    writeImage(id, image, width, height, "rt-ispc-built.ppm");
+
+    int nPixels = width * height;
+    float *refImage = new float[nPixels];
+    int *refId = new int[nPixels];
+    raytrace_ispc_tasks(width, height, baseWidth, baseHeight, raster2camera,
+                        camera2world, refImage, refId, loadedNodes, triangles);
+    int mismatches = 0;
+    for (int i = 0; i < nPixels; ++i) {
+        float tol = 1e-4f * std::max(1.f, fabsf(refImage[i]));
+        if (fabsf(image[i] - refImage[i]) > tol ||
+            (id[i] != refId[i] && image[i] != refImage[i]))
+            ++mismatches;
+    }
+    if (mismatches > 0)
+        fprintf(stderr, "Built BVH: %d of %d pixels differ from the loaded "
+                "BVH's render\n", mismatches, nPixels);
+
+    delete[] refImage;
+    delete[] refId;
+    delete[] nodes;
+    delete[] sortedTris;
+    return mismatches == 0;
+}
+
+
+/* Reads the serialized BVH and triangles from a .bvh file. */
+static bool readBVH(const char *fn, LinearBVHNode *&nodes, uint &nNodes,
+                    Triangle *&triangles, uint &nTris) {
+#define READ(var, n)                                            \
+    if (fread(&(var), sizeof(var), n, f) != (unsigned int)n) {  \
+        fprintf(stderr, "Unexpected EOF reading scene file\n"); \
+        fclose(f);                                              \
+        return false;                                           \
+    } else /* eat ; */
+
+    FILE *f = fopen(fn, "rb");
     if (!f) {
-        perror(fnbuf);
-        return 1;
+        perror(fn);
+        return false;
     }
 
     // The BVH file starts with an int that gives the total number of BVH
     // nodes
-    uint nNodes;
     READ(nNodes, 1);
 
-    LinearBVHNode *nodes = new LinearBVHNode[nNodes];
+    nodes = new LinearBVHNode[nNodes];
     for (unsigned int i = 0; i < nNodes; ++i) {
         // Each node is 6x floats for a boox, then an integer for an offset
         // to the second child node, then an integer that encodes the type
@@ -181,9 +625,8 @@ int main(int argc, char *argv[]) {
     }
 
     // And then read the triangles 
-    uint nTris;
     READ(nTris, 1);
-    Triangle *triangles = new Triangle[nTris];
+    triangles = new Triangle[nTris];
     for (uint i = 0; i < nTris; ++i) {
         // 9x floats for the 3 vertices
         float v[9];
@@ -198,6 +641,114 @@ int main(int argc, char *argv[]) {
         triangles[i].id = i+1;
     }
     fclose(f);
+    return true;
+
+#undef READ
+}
+
+
+int main(int argc, char *argv[]) {
+    static unsigned int test_iterations[] = {3, 7, 1};
+    float scale = 1.f;
+    int streamRays = 0, wideRays = 0;
+    bool rebuild = false;
+    const char *filename = NULL;
+    if (argc < 2) usage();
+    filename = argv[1];
+    int nOptions = 0;
+    for (int i = 2; i < argc && strncmp(argv[i], "--", 2) == 0; ++i, ++nOptions) {
+        if (strncmp(argv[i], "--scale=", 8) == 0)
+            scale = atof(argv[i] + 8);
+        else if (strncmp(argv[i], "--stream=", 9) == 0)
+            streamRays = atoi(argv[i] + 9);
+        else if (strncmp(argv[i], "--wide=", 7) == 0)
+            wideRays = atoi(argv[i] + 7);
+        else if (strcmp(argv[i], "--build") == 0)
+            rebuild = true;
+        else
+            usage();
+    }
+    if (argc - 2 - nOptions == 3) {
+        for (int i = 0; i < 3; i++) {
+            test_iterations[i] = atoi(argv[argc - 3 + i]);
+        }
+    }
+
+#define READ(var, n)                                            \
+    if (fread(&(var), sizeof(var), n, f) != (unsigned int)n) {  \
+        fprintf(stderr, "Unexpected EOF reading scene file\n"); \
+        return 1;                                               \
+    } else /* eat ; */                                                     
+
+    //
+    // Read the camera specification information from the camera file
+    //
+    char fnbuf[1024];
+    sprintf(fnbuf, "%s.camera", filename);
+    FILE *f = fopen(fnbuf, "rb");
+    if (!f) {
+        perror(fnbuf);
+        return 1;
+    }
+
+    //
+    // Nothing fancy, and trouble if we run on a big-endian system, just
+    // fread in the bits
+    //
+    int baseWidth, baseHeight;
+    float camera2world[4][4], raster2camera[4][4];
+    READ(baseWidth, 1);
+    READ(baseHeight, 1);
+    READ(camera2world[0][0], 16);
+    READ(raster2camera[0][0], 16);
+    fclose(f);
+#undef READ
+
+    //
+    // Map the nodes and triangles in place from the aligned .bvh.mmap
+    // version of the scene, creating it from the .bvh file the first time
+    // around (and whenever the .bvh file changes).
+    //
+    reset_and_start_timer();
+    const char magic[8] = "ISPCBVH";
+    MappedFile sceneFile;
+    const LinearBVHNode *nodes = NULL;
+    const Triangle *triangles = NULL;
+    uint nNodes, nTris;
+    LinearBVHNode *loadedNodes = NULL;
+    Triangle *loadedTriangles = NULL;
+    char bvhName[1024];
+    sprintf(bvhName, "%s.bvh", filename);
+    sprintf(fnbuf, "%s.bvh.mmap", filename);
+    if (!sceneFile.open(fnbuf, magic, 1, bvhName)) {
+        if (!readBVH(bvhName, loadedNodes, nNodes, loadedTriangles, nTris))
+            return 1;
+        double readTime = get_elapsed_mcycles();
+        const void *data[2] = { loadedNodes, loadedTriangles };
+        uint64_t size[2] = { nNodes * sizeof(LinearBVHNode),
+                             nTris * sizeof(Triangle) };
+        if (writeMappedFile(fnbuf, magic, 1, 2, data, size, bvhName))
+            printf("Converted %s to %s (reading it took %.3f million cycles)\n",
+                   bvhName, fnbuf, readTime);
+        reset_and_start_timer();
+        if (!sceneFile.open(fnbuf, magic, 1, bvhName)) {
+            // Couldn't write or map the converted file; just use the data
+            // that was read into memory.
+            nodes = loadedNodes;
+            triangles = loadedTriangles;
+        }
+    }
+    if (nodes == NULL) {
+        delete[] loadedNodes;
+        delete[] loadedTriangles;
+        nodes = (const LinearBVHNode *)sceneFile.section(0);
+        nNodes = (uint)(sceneFile.sectionSize(0) / sizeof(LinearBVHNode));
+        triangles = (const Triangle *)sceneFile.section(1);
+        nTris = (uint)(sceneFile.sectionSize(1) / sizeof(Triangle));
+    }
+    printf("Loaded %u BVH nodes and %u triangles in %.3f million cycles, "
+           "peak RSS %.1f MB\n", nNodes, nTris, get_elapsed_mcycles(),
+           peakRSSMegabytes());
 
     int height = int(baseHeight * scale);
     int width = int(baseWidth * scale);
@@ -267,5 +818,18 @@ int main(int argc, char *argv[]) {
 
     writeImage(id, image, width, height, "rt-serial.ppm");
 
+    if (streamRays > 0) {
+        streamBenchmark(streamRays, test_iterations[1], nodes, triangles);
+        if (!deepStreamCheck())
+            return 1;
+    }
+    if (wideRays > 0)
+        wideBenchmark(wideRays, test_iterations[1], nodes, nNodes, triangles);
+    if (rebuild &&
+        !buildBenchmark(test_iterations[1], nodes, triangles, nTris, width,
+                        height, baseWidth, baseHeight, raster2camera,
+                        camera2world, image, id))
+        return 1;
+
     return 0;
 }
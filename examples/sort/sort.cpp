@@ -41,6 +41,7 @@
 #include <sstream>
 #include <cassert>
 #include <iomanip>
+#include <stdint.h>
 #include "../timing.h"
 #include "sort_ispc.h"
 
@@ -72,6 +73,19 @@ static void progressBar(const int x, const int n, const int width = 50)
   std::cout << (x == n-1 ? "\n" : "\r") << std::flush;
 }
 
+/* Checks that keys[] is sorted, that values[] maps every key back to the
+   input and that equal keys kept their input order. */
+template <typename KEY>
+static bool checkSorted (int n, const KEY input[], const KEY keys[], const int values[])
+{
+  for (int i = 0; i < n; i ++)
+  {
+    if (values[i] < 0 || values[i] >= n || input[values[i]] != keys[i]) return false;
+    if (i > 0 && (keys[i-1] > keys[i] || (keys[i-1] == keys[i] && values[i-1] >= values[i]))) return false;
+  }
+  return true;
+}
+
 int main (int argc, char *argv[])
 {
   int i, j, n = argc == 1 ? 1000000 : atoi(argv[1]), m = n < 100 ? 1 : 50, l = n < 100 ? n : RAND_MAX;
@@ -135,7 +149,64 @@ int main (int argc, char *argv[])
 
   printf("\t\t\t\t(%.2fx speedup from ISPC, %.2fx speedup from ISPC + tasks)\n", tSerial/tISPC1, tSerial/tISPC2);
 
+  /* Radix sort engine: throughput of the key-value sort with 32 and 64 bit
+     keys against the bucket sort above, for 1 to 64 tasks (the task system
+     runs them on at most one thread per core). */
+  unsigned int *input32 = new unsigned int [n], *keys32 = new unsigned int [n];
+  uint64_t *input64 = new uint64_t [n], *keys64 = new uint64_t [n];
+  int *values = new int [n];
+  int reps = std::min(m, 10);
+  bool ok = true;
+
+  srand (0);
+  for (j = 0; j < n; j ++)
+  {
+    input32 [j] = rand() % l;
+    input64 [j] = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+  }
+
+  printf("\n[radix sort engine]:\tMkeys/s (best of %d runs)\n", reps);
+  printf("\ttasks\tbucket sort\tradix 32-bit\tradix 64-bit\n");
+
+  for (int tasks = 1; tasks <= 64; tasks *= 2)
+  {
+    double secBucket = 1e30, secRadix32 = 1e30, secRadix64 = 1e30;
+
+    for (i = 0; i < reps; i ++)
+    {
+      std::copy (input32, input32 + n, code);
+      reset_and_start_timer();
+      sort_ispc (n, code, order, tasks);
+      secBucket = std::min(secBucket, get_elapsed_sec());
+
+      std::copy (input32, input32 + n, keys32);
+      for (j = 0; j < n; j ++) values [j] = j;
+      reset_and_start_timer();
+      radix_sort32_ispc (n, keys32, values, tasks);
+      secRadix32 = std::min(secRadix32, get_elapsed_sec());
+      ok = ok && checkSorted (n, input32, keys32, values);
+
+      std::copy (input64, input64 + n, keys64);
+      for (j = 0; j < n; j ++) values [j] = j;
+      reset_and_start_timer();
+      radix_sort64_ispc (n, keys64, values, tasks);
+      secRadix64 = std::min(secRadix64, get_elapsed_sec());
+      ok = ok && checkSorted (n, input64, keys64, values);
+    }
+
+    printf("\t%d\t%.2f\t\t%.2f\t\t%.2f\n", tasks, n / secBucket * 1e-6,
+           n / secRadix32 * 1e-6, n / secRadix64 * 1e-6);
+  }
+
+  if (!ok) printf("ERROR: radix sort engine produced a wrong result\n");
+
+  delete [] input32;
+  delete [] keys32;
+  delete [] input64;
+  delete [] keys64;
+  delete [] values;
+
   delete code;
   delete order;
-  return 0;
+  return ok ? 0 : 1;
 }
@@ -104,6 +104,9 @@ static inline double rtc(void)
             
 static uint64_t start,  end;
 static double  tstart, tend;
+#ifdef WIN32
+static LARGE_INTEGER qpcStart;
+#endif
 
 static inline void reset_and_start_timer()
 {
@@ -111,6 +114,8 @@ static inline void reset_and_start_timer()
 #ifndef WIN32
     // Unused in Windows build, rtc() causing link errors
     tstart = rtc();
+#else
+    QueryPerformanceCounter(&qpcStart);
 #endif
 }
 
@@ -130,3 +135,17 @@ static inline double get_elapsed_msec()
     return (tend - tstart)*1e3;
 }
 #endif
+
+/* Returns the number of seconds of wall-clock time elapsed since the last
+   reset_and_start_timer() call. */
+static inline double get_elapsed_sec()
+{
+#ifndef WIN32
+    return get_elapsed_msec() * 1e-3;
+#else
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+    return (double)(now.QuadPart - qpcStart.QuadPart) / (double)freq.QuadPart;
+#endif
+}
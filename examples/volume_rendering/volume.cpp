@@ -40,8 +40,12 @@
 
 #include <cstdlib>
 #include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
 #include <algorithm>
 #include "../timing.h"
+#include "../mapped_file.h"
 #include "volume_ispc.h"
 using namespace ispc;
 
@@ -110,7 +114,7 @@ loadCamera(const char *fn, int *width, int *height, float raster2camera[4][4],
    as the first three values (as integer strings), then x*y*z
    floating-point values (also as strings) to give the densities.  */
 static float *
-loadVolume(const char *fn, int n[3]) {
+readVolumeText(const char *fn, int n[3]) {
     FILE *f = fopen(fn, "r");
     if (!f) {
         perror(fn);
@@ -130,20 +134,275 @@ loadVolume(const char *fn, int n[3]) {
             exit(1);
         }
     }
+    fclose(f);
 
     return v;
 }
 
 
+/* Load a volume density file.  The densities are mapped in place from an
+   aligned binary version of the file (<fn>.mmap), which holds the
+   resolution in its first section and the densities in the second one;
+   it is created from the text file the first time around (and whenever
+   the text file changes).  If the binary
+   file can't be written, the densities read from the text file are used
+   directly. */
+static float *
+loadVolume(const char *fn, int n[3], MappedFile &volumeFile) {
+    const char magic[8] = "ISPCVOL";
+    char mappedName[1024];
+    sprintf(mappedName, "%s.mmap", fn);
+
+    reset_and_start_timer();
+    if (!volumeFile.open(mappedName, magic, 1, fn)) {
+        float *v = readVolumeText(fn, n);
+        double readTime = get_elapsed_mcycles();
+        const void *data[2] = { n, v };
+        uint64_t size[2] = { 3 * sizeof(int),
+                             (uint64_t)n[0] * n[1] * n[2] * sizeof(float) };
+        if (writeMappedFile(mappedName, magic, 1, 2, data, size, fn))
+            printf("Converted %s to %s (parsing it took %.3f million cycles)\n",
+                   fn, mappedName, readTime);
+        reset_and_start_timer();
+        if (!volumeFile.open(mappedName, magic, 1, fn)) {
+            printf("Loaded %d x %d x %d volume in %.3f million cycles\n",
+                   n[0], n[1], n[2], readTime);
+            return v;
+        }
+        delete[] v;
+    }
+
+    memcpy(n, volumeFile.section(0), 3 * sizeof(int));
+    float *density = (float *)volumeFile.section(1);
+    if (volumeFile.sectionSize(1) < (uint64_t)n[0] * n[1] * n[2] * sizeof(float)) {
+        fprintf(stderr, "%s: truncated density data\n", mappedName);
+        exit(1);
+    }
+    printf("Mapped %d x %d x %d volume in %.3f million cycles, peak RSS %.1f MB\n",
+           n[0], n[1], n[2], get_elapsed_mcycles(), peakRSSMegabytes());
+    return density;
+}
+
+
+/* Macrocells for empty space skipping, as used by volume_skip_ispc_tasks():
+   each one covers MACROCELL_SIZE^3 voxels. */
+#define MACROCELL_SIZE 8   // must match volume.ispc
+
+
+/* Bricked volumes, as used by volume_bricked_ispc_tasks(): BRICK_SIZE^3
+   voxel bricks stored in Morton order, with a page table giving the
+   brick index for each brick of the volume in x, y, z order.  Empty
+   bricks all share brick zero.  The file's sections are the resolution,
+   the bricks and the page table. */
+#define BRICK_SIZE 8
+#define BRICK_VOXELS (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+
+struct BrickedVolume {
+    int n[3];
+    const float *bricks;
+    const unsigned int *pageTable;
+    uint64_t nStoredBricks;
+};
+
+
+/* Density source for dense volumes read from .vol files */
+struct DenseDensity {
+    DenseDensity(const float *d, const int n[3]) : density(d) {
+        nx = n[0];
+        ny = n[1];
+    }
+    float operator()(int x, int y, int z) const {
+        return density[((uint64_t)z * ny + y) * nx + x];
+    }
+    const float *density;
+    int nx, ny;
+};
+
+
+/* Procedural density for synthetic volumes of any resolution: a ball of
+   smoke with some swirling structure, empty towards the corners. */
+struct SyntheticDensity {
+    SyntheticDensity(const int n[3]) {
+        for (int i = 0; i < 3; ++i)
+            scale[i] = 1.f / n[i];
+    }
+    float operator()(int x, int y, int z) const {
+        float px = (x + .5f) * scale[0] - .5f;
+        float py = (y + .5f) * scale[1] - .5f;
+        float pz = (z + .5f) * scale[2] - .5f;
+        float r = sqrtf(px*px + py*py + pz*pz);
+        float falloff = 1.f - r / .45f;
+        if (falloff <= 0.f)
+            return 0.f;
+        float swirl = sinf(23.f * px + 7.f * sinf(11.f * pz)) *
+                      sinf(19.f * py + 5.f * sinf(13.f * px)) *
+                      sinf(17.f * pz + 3.f * sinf(9.f * py));
+        return std::max(0.f, falloff * (.6f + .4f * swirl)) * 2.f;
+    }
+    float scale[3];
+};
+
+
+static inline unsigned int
+compactBits3(uint64_t code) {
+    uint64_t x = code & 0x1249249249249249ull;
+    x = (x | (x >> 2))  & 0x10c30c30c30c30c3ull;
+    x = (x | (x >> 4))  & 0x100f00f00f00f00full;
+    x = (x | (x >> 8))  & 0x1f0000ff0000ffull;
+    x = (x | (x >> 16)) & 0x1f00000000ffffull;
+    x = (x | (x >> 32)) & 0x1fffffull;
+    return (unsigned int)x;
+}
+
+
+/* Writes a bricked version of the given density source to path.  Bricks
+   are visited (and stored) in Morton order and streamed out one at a
+   time, so the volume doesn't need to fit in memory; only the page table
+   is kept around. */
+template <typename Density> static bool
+writeBrickedVolume(const char *path, const char magic[8], const int n[3],
+                   const Density &density, const char *source) {
+    int nb[3];
+    int side = 1;
+    for (int i = 0; i < 3; ++i) {
+        nb[i] = (n[i] + BRICK_SIZE - 1) / BRICK_SIZE;
+        while (side < nb[i])
+            side *= 2;
+    }
+    uint64_t nBricks = (uint64_t)nb[0] * nb[1] * nb[2];
+    unsigned int *pageTable = new unsigned int[nBricks];
+
+    MappedFileWriter writer;
+    bool ok = writer.open(path, magic, 1, source) && writer.beginSection() &&
+        writer.write(n, 3 * sizeof(int));
+    writer.endSection();
+
+    // Brick zero is the shared empty brick.
+    float brick[BRICK_VOXELS];
+    memset(brick, 0, sizeof(brick));
+    ok = ok && writer.beginSection() && writer.write(brick, sizeof(brick));
+    unsigned int nStored = 1;
+    uint64_t sideCubed = (uint64_t)side * side * side;
+    for (uint64_t code = 0; ok && code < sideCubed; ++code) {
+        int bx = compactBits3(code), by = compactBits3(code >> 1);
+        int bz = compactBits3(code >> 2);
+        if (bx >= nb[0] || by >= nb[1] || bz >= nb[2])
+            continue;
+
+        bool empty = true;
+        for (int z = 0; z < BRICK_SIZE; ++z)
+            for (int y = 0; y < BRICK_SIZE; ++y)
+                for (int x = 0; x < BRICK_SIZE; ++x) {
+                    int vx = std::min(bx * BRICK_SIZE + x, n[0] - 1);
+                    int vy = std::min(by * BRICK_SIZE + y, n[1] - 1);
+                    int vz = std::min(bz * BRICK_SIZE + z, n[2] - 1);
+                    float d = density(vx, vy, vz);
+                    brick[(z * BRICK_SIZE + y) * BRICK_SIZE + x] = d;
+                    empty = empty && (d == 0.f);
+                }
+
+        uint64_t index = ((uint64_t)bz * nb[1] + by) * nb[0] + bx;
+        if (empty)
+            pageTable[index] = 0;
+        else {
+            pageTable[index] = nStored++;
+            ok = writer.write(brick, sizeof(brick));
+        }
+    }
+    writer.endSection();
+
+    ok = ok && writer.beginSection() &&
+        writer.write(pageTable, nBricks * sizeof(unsigned int));
+    writer.endSection();
+    delete[] pageTable;
+    return ok && writer.close();
+}
+
+
+/* Maps a bricked volume file, creating it from the given density source
+   the first time around.  If the densities come from a file, source gives
+   its path, and the bricked volume is recreated whenever it changes. */
+template <typename Density> static bool
+loadBrickedVolume(const char *path, const int n[3], const Density &density,
+                  const char *source, MappedFile &file, BrickedVolume &vol) {
+    const char magic[8] = "ISPCBRK";
+    reset_and_start_timer();
+    if (!file.open(path, magic, 1, source)) {
+        if (!writeBrickedVolume(path, magic, n, density, source)) {
+            fprintf(stderr, "Unable to write bricked volume %s\n", path);
+            return false;
+        }
+        printf("Wrote bricked volume %s in %.3f million cycles\n", path,
+               get_elapsed_mcycles());
+        reset_and_start_timer();
+        if (!file.open(path, magic, 1, source))
+            return false;
+    }
+
+    memcpy(vol.n, file.section(0), 3 * sizeof(int));
+    vol.bricks = (const float *)file.section(1);
+    vol.pageTable = (const unsigned int *)file.section(2);
+    vol.nStoredBricks = file.sectionSize(1) / (BRICK_VOXELS * sizeof(float));
+    uint64_t nBricks = (uint64_t)((vol.n[0] + BRICK_SIZE - 1) / BRICK_SIZE) *
+        ((vol.n[1] + BRICK_SIZE - 1) / BRICK_SIZE) *
+        ((vol.n[2] + BRICK_SIZE - 1) / BRICK_SIZE);
+    if (file.sectionSize(2) < nBricks * sizeof(unsigned int)) {
+        fprintf(stderr, "%s: truncated page table\n", path);
+        return false;
+    }
+    printf("Mapped %d x %d x %d bricked volume (%.1f MB of bricks, %.1f%% "
+           "of them empty) in %.3f million cycles\n", vol.n[0], vol.n[1],
+           vol.n[2], file.sectionSize(1) / (1024. * 1024.),
+           100. * (1. - double(vol.nStoredBricks - 1) / nBricks),
+           get_elapsed_mcycles());
+    return true;
+}
+
+
+/* Renders a bricked volume with the tiles in scanline order and in
+   Z-order, reporting the minimum time for each. */
+static void
+benchmarkBricked(const BrickedVolume &vol, unsigned int iterations,
+                 const float raster2camera[4][4],
+                 const float camera2world[4][4], int width, int height,
+                 float image[], double denseTime) {
+    int n[3] = { vol.n[0], vol.n[1], vol.n[2] };
+    for (int morton = 0; morton < 2; ++morton) {
+        double minTime = 1e30;
+        for (unsigned int i = 0; i < iterations; ++i) {
+            reset_and_start_timer();
+            volume_bricked_ispc_tasks(vol.bricks, vol.pageTable, n,
+                                      raster2camera, camera2world,
+                                      width, height, image, morton != 0);
+            double dt = get_elapsed_mcycles();
+            minTime = std::min(minTime, dt);
+        }
+        printf("[volume ispc + tasks, bricked, %s tiles]:\t[%.3f] million cycles",
+               morton ? "Z-order" : "scanline", minTime);
+        if (denseTime > 0.)
+            printf(" (%.2fx vs. dense)", denseTime / minTime);
+        printf("\n");
+    }
+    writePPM(image, width, height, "volume-ispc-bricked.ppm");
+    printf("Peak RSS %.1f MB\n", peakRSSMegabytes());
+}
+
+
 int main(int argc, char *argv[]) {
     static unsigned int test_iterations[] = {3, 7, 1};
     if (argc < 3) {
-        fprintf(stderr, "usage: volume <camera.dat> <volume_density.vol> [ispc iterations] [tasks iterations] [serial iterations]\n");
+        fprintf(stderr, "usage: volume <camera.dat> <volume_density.vol | --synthetic=<resolution>> [--dense] [ispc iterations] [tasks iterations] [serial iterations]\n");
         return 1;
     }
-    if (argc == 6) {
+    bool withDense = false;
+    int argBase = 3;
+    if (argc > 3 && strcmp(argv[3], "--dense") == 0) {
+        withDense = true;
+        ++argBase;
+    }
+    if (argc == argBase + 3) {
         for (int i = 0; i < 3; i++) {
-            test_iterations[i] = atoi(argv[3 + i]);
+            test_iterations[i] = atoi(argv[argBase + i]);
         }
     }
 
@@ -155,8 +414,51 @@ int main(int argc, char *argv[]) {
     loadCamera(argv[1], &width, &height, raster2camera, camera2world);
     float *image = new float[width*height];
 
+    //
+    // Synthetic volumes of arbitrary resolution are only rendered in
+    // bricked form (and densely, with --dense, if they fit in memory),
+    // so that their size can be pushed past the size of the last level
+    // cache and of main memory.
+    //
+    if (strncmp(argv[2], "--synthetic=", 12) == 0) {
+        int res = atoi(argv[2] + 12);
+        int n[3] = { res, res, res };
+        char path[1024];
+        sprintf(path, "synthetic-%d.bricks.mmap", res);
+        SyntheticDensity synthetic(n);
+        MappedFile brickFile;
+        BrickedVolume vol;
+        if (!loadBrickedVolume(path, n, synthetic, NULL, brickFile, vol))
+            return 1;
+
+        double denseTime = 0.;
+        if (withDense) {
+            float *density = new float[(uint64_t)res * res * res];
+            for (int z = 0; z < res; ++z)
+                for (int y = 0; y < res; ++y)
+                    for (int x = 0; x < res; ++x)
+                        density[((uint64_t)z * res + y) * res + x] = synthetic(x, y, z);
+            denseTime = 1e30;
+            for (unsigned int i = 0; i < test_iterations[1]; ++i) {
+                reset_and_start_timer();
+                volume_ispc_tasks(density, n, raster2camera, camera2world,
+                                  width, height, image);
+                denseTime = std::min(denseTime, get_elapsed_mcycles());
+            }
+            printf("[volume ispc + tasks, dense]:\t[%.3f] million cycles (%.1f MB)\n",
+                   denseTime, res * (res * (res * 4.)) / (1024. * 1024.));
+            writePPM(image, width, height, "volume-ispc-dense.ppm");
+            delete[] density;
+        }
+
+        benchmarkBricked(vol, test_iterations[1], raster2camera, camera2world,
+                         width, height, image, denseTime);
+        return 0;
+    }
+
     int n[3];
-    float *density = loadVolume(argv[2], n);
+    MappedFile volumeFile;
+    float *density = loadVolume(argv[2], n, volumeFile);
 
     //
     // Compute the image using the ispc implementation; report the minimum
@@ -196,6 +498,46 @@ int main(int argc, char *argv[]) {
     printf("[volume ispc + tasks]:\t\t[%.3f] million cycles\n", minISPCtasks);
     writePPM(image, width, height, "volume-ispc-tasks.ppm");
 
+    //
+    // Build the macrocell grid and render again, stepping over the
+    // macrocells that are empty.
+    //
+    int nCells[3];
+    for (int i = 0; i < 3; ++i)
+        nCells[i] = (n[i] + MACROCELL_SIZE - 1) / MACROCELL_SIZE;
+    int totalCells = nCells[0] * nCells[1] * nCells[2];
+    float *cellMax = new float[totalCells];
+    reset_and_start_timer();
+    volume_macrocells_ispc_tasks(density, n, cellMax);
+    double macrocellTime = get_elapsed_mcycles();
+    int nEmpty = 0;
+    for (int i = 0; i < totalCells; ++i)
+        if (cellMax[i] == 0.f)
+            ++nEmpty;
+    printf("[macrocell build]:\t\t[%.3f] million cycles (%d of %d cells empty)\n",
+           macrocellTime, nEmpty, totalCells);
+
+    float *taskImage = new float[width * height];
+    memcpy(taskImage, image, width * height * sizeof(float));
+    double minISPCskip = 1e30;
+    for (unsigned int i = 0; i < test_iterations[1]; ++i) {
+        reset_and_start_timer();
+        volume_skip_ispc_tasks(density, n, cellMax, raster2camera, camera2world,
+                               width, height, image);
+        double dt = get_elapsed_mcycles();
+        printf("@time of ISPC + TASKS + skipping run:\t\t[%.3f] million cycles\n", dt);
+        minISPCskip = std::min(minISPCskip, dt);
+    }
+
+    float maxError = 0.f;
+    for (int i = 0; i < width * height; ++i)
+        maxError = std::max(maxError, fabsf(image[i] - taskImage[i]));
+    printf("[volume ispc + tasks + skipping]:\t[%.3f] million cycles (%.2fx speedup, max difference %g)\n",
+           minISPCskip, minISPCtasks / minISPCskip, maxError);
+    writePPM(image, width, height, "volume-ispc-skip.ppm");
+    delete[] taskImage;
+    delete[] cellMax;
+
     // Clear out the buffer
     for (int i = 0; i < width * height; ++i)
         image[i] = 0.;
@@ -219,6 +561,19 @@ int main(int argc, char *argv[]) {
 
     printf("\t\t\t\t(%.2fx speedup from ISPC, %.2fx speedup from ISPC + tasks)\n", 
            minSerial/minISPC, minSerial / minISPCtasks);
+    printf("Peak RSS %.1f MB\n", peakRSSMegabytes());
+
+    //
+    // Finally, render the same volume in bricked form.
+    //
+    char brickPath[1024];
+    sprintf(brickPath, "%s.bricks.mmap", argv[2]);
+    MappedFile brickFile;
+    BrickedVolume vol;
+    if (loadBrickedVolume(brickPath, n, DenseDensity(density, n), argv[2],
+                          brickFile, vol))
+        benchmarkBricked(vol, test_iterations[1], raster2camera, camera2world,
+                         width, height, image, minISPCtasks);
 
     return 0;
 }
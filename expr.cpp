@@ -4072,25 +4072,14 @@ ExprList::GetConstant(const Type *type) const {
                 llvm::dyn_cast<llvm::VectorType>(lt);
             AssertPos(pos, lvt != NULL);
 
-            // Uniform short vectors are stored as vectors of length
-            // rounded up to the native vector width.  So we add additional
-            // undef values here until we get the right size.
-            int vectorWidth = g->target->getNativeVectorWidth();
-            const VectorType *vt = CastType<VectorType>(type);
-            const AtomicType *bt = vt->GetElementType();
-
-            if (Type::Equal(bt->GetAsUniformType(), AtomicType::UniformInt64) ||
-                Type::Equal(bt->GetAsUniformType(), AtomicType::UniformUInt64) ||
-                Type::Equal(bt->GetAsUniformType(), AtomicType::UniformDouble)) {
-                // target.nativeVectorWidth should be in terms of 32-bit
-                // values, so for the 64-bit guys, it takes half as many of
-                // them to fill the native width
-                vectorWidth /= 2;
-            }
-
-            while ((cv.size() % vectorWidth) != 0) {
+            // Uniform short vectors may be stored as vectors with more
+            // elements than they have: by default, their length is
+            // rounded up to a multiple of the target's native vector
+            // width, and with --short-vector-layout=portable, to a power
+            // of two (see VectorType::getVectorMemoryCount()).  So we add
+            // additional undef values here until we get the right size.
+            while (cv.size() < lvt->getNumElements())
                 cv.push_back(llvm::UndefValue::get(lvt->getElementType()));
-            }
 
             return llvm::ConstantVector::get(cv);
         }
@@ -5011,8 +5000,69 @@ VectorMemberExpr::GetLValueType() const {
 }
 
 
+/** Returns the given elements of the value of a uniform short vector:
+    a single element is an extractelement and a multi-element swizzle is a
+    shufflevector, with any padding elements of the result left undefined.
+ */
+static llvm::Value *
+lUniformVectorSwizzle(FunctionEmitContext *ctx, llvm::Value *value,
+                      const std::string &identifier,
+                      const VectorType *exprVectorType,
+                      const VectorType *memberType, SourcePos pos) {
+    if (value == NULL) {
+        AssertPos(pos, m->errorCount > 0);
+        return NULL;
+    }
+
+    std::vector<int> indices;
+    for (size_t i = 0; i < identifier.size(); ++i) {
+        int idx = lIdentifierToVectorElement(identifier[i]);
+        if (idx == -1) {
+            Error(pos, "Invalid swizzle charcter '%c' in swizzle \"%s\".",
+                  identifier[i], identifier.c_str());
+            return NULL;
+        }
+        if (idx >= exprVectorType->GetElementCount()) {
+            Error(pos, "Vector element identifier '%c' is out of range "
+                  "for type \"%s\".", identifier[i],
+                  exprVectorType->GetString().c_str());
+            return NULL;
+        }
+        indices.push_back(idx);
+    }
+
+    ctx->SetDebugPos(pos);
+    if (indices.size() == 1)
+        return ctx->ExtractInst(value, indices[0],
+                                LLVMGetName(value, ("_" + identifier).c_str()));
+
+    llvm::VectorType *resultType =
+        llvm::dyn_cast<llvm::VectorType>(memberType->LLVMType(g->ctx));
+    AssertPos(pos, resultType != NULL);
+
+    std::vector<llvm::Constant *> mask;
+    for (unsigned int i = 0; i < resultType->getNumElements(); ++i)
+        if (i < indices.size())
+            mask.push_back(LLVMInt32(indices[i]));
+        else
+            mask.push_back(llvm::UndefValue::get(LLVMTypes::Int32Type));
+
+    return ctx->ShuffleInst(value, llvm::UndefValue::get(value->getType()),
+                            llvm::ConstantVector::get(mask),
+                            LLVMGetName(value, "_swizzle"));
+}
+
+
 llvm::Value *
 VectorMemberExpr::GetValue(FunctionEmitContext *ctx) const {
+    const Type *exprType = (expr != NULL) ? expr->GetType() : NULL;
+    if (dereferenceExpr == false && exprType != NULL &&
+        exprType->IsUniformType() && CastType<VectorType>(exprType) != NULL)
+        // Uniform short vectors are held in LLVM vectors, so we can work
+        // directly on the vector's value rather than going through memory.
+        return lUniformVectorSwizzle(ctx, expr->GetValue(ctx), identifier,
+                                     exprVectorType, memberType, pos);
+
     if (identifier.length() == 1) {
         return MemberExpr::GetValue(ctx);
     }
@@ -464,7 +464,10 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
     m_hasTrigonometry(false),
     m_hasRsqrtd(false),
     m_hasRcpd(false),
-    m_hasVecPrefetch(false)
+    m_hasVecPrefetch(false),
+    m_hasVecCountZeros(false),
+    m_hasCrc32c(false),
+    m_hasPdepPext(false)
 {
     CPUtype CPUID = CPU_None, CPUfromISA = CPU_None;
     AllCPUs a;
@@ -631,6 +634,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 4;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 32;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_Nehalem;
     }
     else if (!strcasecmp(isa, "sse4x2") ||
@@ -643,6 +647,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 8;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 32;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_Nehalem;
     }
     else if (!strcasecmp(isa, "sse4-i8x16")) {
@@ -653,6 +658,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 16;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 8;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_Nehalem;
     }
     else if (!strcasecmp(isa, "sse4-i16x8")) {
@@ -663,6 +669,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 8;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 16;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_Nehalem;
     }
     else if (!strcasecmp(isa, "generic-4") ||
@@ -775,6 +782,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 4;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 32;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_SandyBridge;
     }
     else if (!strcasecmp(isa, "avx") ||
@@ -787,6 +795,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 8;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 32;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_SandyBridge;
     }
     else if (!strcasecmp(isa, "avx-i64x4") ||
@@ -798,6 +807,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 4;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 64;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_SandyBridge;
     }
     else if (!strcasecmp(isa, "avx-x2") ||
@@ -810,6 +820,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_vectorWidth = 16;
         this->m_maskingIsFree = false;
         this->m_maskBitCount = 32;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_SandyBridge;
     }
     else if (!strcasecmp(isa, "avx1.1") ||
@@ -823,6 +834,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_maskBitCount = 32;
         this->m_hasHalf = true;
         this->m_hasRand = true;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_IvyBridge;
     }
     else if (!strcasecmp(isa, "avx1.1-x2") ||
@@ -836,6 +848,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_maskBitCount = 32;
         this->m_hasHalf = true;
         this->m_hasRand = true;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_IvyBridge;
     }
     else if (!strcasecmp(isa, "avx1.1-i64x4")) {
@@ -848,6 +861,7 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_maskBitCount = 64;
         this->m_hasHalf = true;
         this->m_hasRand = true;
+        this->m_hasCrc32c = true;
         CPUfromISA = CPU_IvyBridge;
     }
     else if (!strcasecmp(isa, "avx2") ||
@@ -862,6 +876,8 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_hasHalf = true;
         this->m_hasRand = true;
         this->m_hasGather = true;
+        this->m_hasCrc32c = true;
+        this->m_hasPdepPext = true;
         CPUfromISA = CPU_Haswell;
     }
     else if (!strcasecmp(isa, "avx2-x2") ||
@@ -876,6 +892,8 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_hasHalf = true;
         this->m_hasRand = true;
         this->m_hasGather = true;
+        this->m_hasCrc32c = true;
+        this->m_hasPdepPext = true;
         CPUfromISA = CPU_Haswell;
     }
     else if (!strcasecmp(isa, "avx2-i64x4")) {
@@ -889,6 +907,8 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_hasHalf = true;
         this->m_hasRand = true;
         this->m_hasGather = true;
+        this->m_hasCrc32c = true;
+        this->m_hasPdepPext = true;
         CPUfromISA = CPU_Haswell;
     }
 #if !defined(LLVM_3_2) && !defined(LLVM_3_3) && !defined(LLVM_3_4) && !defined(LLVM_3_5) && !defined(LLVM_3_6)// LLVM 3.7+
@@ -908,6 +928,9 @@ Target::Target(const char *arch, const char *cpu, const char *isa, bool pic, boo
         this->m_hasTrigonometry = false;
         this->m_hasRsqrtd = this->m_hasRcpd = false;
         this->m_hasVecPrefetch = false;
+        this->m_hasVecCountZeros = true;
+        this->m_hasCrc32c = true;
+        this->m_hasPdepPext = true;
         CPUfromISA = CPU_KNL;
     }
 #endif
@@ -1415,6 +1438,7 @@ Opt::Opt() {
     fastMath = false;
     fastMaskedVload = false;
     force32BitAddressing = true;
+    portableShortVectorLayout = false;
     unrollLoops = true;
     disableAsserts = false;
     disableFMA = false;
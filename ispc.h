@@ -306,6 +306,12 @@ public:
 
     bool hasVecPrefetch() const {return m_hasVecPrefetch;}
 
+    bool hasVecCountZeros() const {return m_hasVecCountZeros;}
+
+    bool hasCrc32c() const {return m_hasCrc32c;}
+
+    bool hasPdepPext() const {return m_hasPdepPext;}
+
 private:
 
     /** llvm Target object representing this target. */
@@ -414,6 +420,18 @@ private:
 
     /** Indicates whether the target has hardware instruction for vector prefetch. */
     bool m_hasVecPrefetch;
+
+    /** Indicates whether the target has vector instructions that count
+        leading zeros in each lane (e.g. AVX-512CD's vplzcntd), which the
+        varying count_leading_zeros() and count_trailing_zeros() use. */
+    bool m_hasVecCountZeros;
+
+    /** Indicates whether the target has the SSE4.2 crc32 instruction. */
+    bool m_hasCrc32c;
+
+    /** Indicates whether the target has the BMI2 pdep and pext
+        instructions. */
+    bool m_hasPdepPext;
 };
 
 
@@ -450,6 +468,13 @@ struct Opt {
      */
     bool force32BitAddressing;
 
+    /** Indicates if uniform short vectors should be padded to the next
+        power of two number of elements (the same on all targets) rather
+        than to a multiple of the target's native vector width.  This
+        changes the layout of these types in the generated header file.
+     */
+    bool portableShortVectorLayout;
+
     /** Indicates whether Assert() statements should be ignored (for
         performance in the generated code). */
     bool disableAsserts;
@@ -236,6 +236,7 @@ void ParserInit() {
     tokenNameRemap["TOKEN_GOTO"] = "\'goto\'";
     tokenNameRemap["TOKEN_IDENTIFIER"] = "identifier";
     tokenNameRemap["TOKEN_IF"] = "\'if\'";
+    tokenNameRemap["TOKEN_INTRINSIC_NAME"] = "LLVM intrinsic";
     tokenNameRemap["TOKEN_IN"] = "\'in\'";
     tokenNameRemap["TOKEN_INLINE"] = "\'inline\'";
     tokenNameRemap["TOKEN_INT"] = "\'int\'";
@@ -350,6 +351,7 @@ FORTRAN_DOUBLE_NUMBER (([0-9]+\.[0-9]*[dD])|([0-9]+\.[0-9]*[dD][-+]?[0-9]+)|([0-
 
 
 IDENT [a-zA-Z_][a-zA-Z_0-9]*
+INTRINSIC_NAME @llvm\.[a-zA-Z_0-9.]+
 ZO_SWIZZLE ([01]+[w-z]+)+|([01]+[rgba]+)+|([01]+[uv]+)+
 
 %%
@@ -429,6 +431,14 @@ while { RT; return TOKEN_WHILE; }
 
 L?\"(\\.|[^\\"])*\" { lStringConst(&yylval, &yylloc); return TOKEN_STRING_LITERAL; }
 
+{INTRINSIC_NAME} {
+    RT;
+    /* Direct call of an LLVM intrinsic, like "@llvm.x86.sse2.pause";
+       drop the leading '@' to get the intrinsic's name. */
+    yylval.stringVal = new std::string(yytext + 1);
+    return TOKEN_INTRINSIC_NAME;
+}
+
 {IDENT} {
     RT;
     /* We have an identifier--is it a type name or an identifier?
@@ -137,6 +137,9 @@ usage(int ret) {
     printf("    [--pic]\t\t\t\tGenerate position-independent code\n");
 #endif // !ISPC_IS_WINDOWS
     printf("    [--quiet]\t\t\t\tSuppress all output\n");
+    printf("    [--short-vector-layout=<option>]\tSelect memory layout of uniform short vectors\n");
+    printf("        native\t\t\t\tPad to a multiple of the target's vector width (default)\n");
+    printf("        portable\t\t\tPad to a power of two, the same on all targets (changes header ABI)\n");
     printf("    ");
     char targetHelp[2048];
     sprintf(targetHelp, "[--target=<t>]\t\t\tSelect target ISA and width.\n"
@@ -538,6 +541,18 @@ int main(int Argc, char *Argv[]) {
 #endif // !ISPC_IS_WINDOWS
         else if (!strcmp(argv[i], "--quiet"))
             g->quiet = true;
+        else if (!strncmp(argv[i], "--short-vector-layout=", 22)) {
+            const char *layout = argv[i] + 22;
+            if (!strcmp(layout, "native"))
+                g->opt.portableShortVectorLayout = false;
+            else if (!strcmp(layout, "portable"))
+                g->opt.portableShortVectorLayout = true;
+            else {
+                fprintf(stderr, "Short vector layout \"%s\" invalid--only "
+                        "\"native\" and \"portable\" are allowed.\n", layout);
+                usage(1);
+            }
+        }
         else if (!strcmp(argv[i], "--yydebug")) {
             extern int yydebug;
             yydebug = 1;
@@ -1137,6 +1137,278 @@ Module::AddFunctionDefinition(const std::string &name, const FunctionType *type,
 }
 
 
+/** Returns true if the LLVM intrinsic with the given name may be used on
+    the current compilation target, and issues an error otherwise.
+    Intrinsics for a specific architecture have its name as the first
+    component of their name ("llvm.x86.*", ...); for x86, we further
+    check that the target's ISA includes the instruction set extension
+    that the intrinsic is from.
+ */
+static bool
+lCheckIntrinsicTarget(const std::string &name, SourcePos pos) {
+    static const char *archNames[] = {
+        "aarch64", "amdgcn", "arm", "bpf", "hexagon", "mips", "nvvm",
+        "ppc", "r600", "s390", "x86", "xcore",
+    };
+
+    size_t archEnd = name.find('.', 5);
+    std::string arch = name.substr(5, archEnd == std::string::npos ?
+                                   std::string::npos : archEnd - 5);
+    bool isTargetIntrinsic = false;
+    for (unsigned int i = 0; i < sizeof(archNames) / sizeof(archNames[0]); ++i)
+        if (arch == archNames[i])
+            isTargetIntrinsic = true;
+    if (isTargetIntrinsic == false)
+        // target-independent intrinsic
+        return true;
+
+    Target::ISA isa = g->target->getISA();
+    bool archMatches = false;
+    if (arch == "x86")
+        archMatches = (isa >= Target::SSE2 && isa <= Target::SKX);
+#ifdef ISPC_NVPTX_ENABLED
+    else if (arch == "nvvm")
+        archMatches = (isa == Target::NVPTX);
+#endif /* ISPC_NVPTX_ENABLED */
+#ifdef ISPC_ARM_ENABLED
+    else if (arch == "arm" || arch == "aarch64")
+        archMatches = (isa == Target::NEON32 || isa == Target::NEON16 ||
+                       isa == Target::NEON8);
+#endif /* ISPC_ARM_ENABLED */
+
+    if (archMatches == false) {
+        Error(pos, "LLVM intrinsic \"%s\" isn't available on the \"%s\" "
+              "target.", name.c_str(), g->target->GetISATargetString());
+        return false;
+    }
+
+    if (arch == "x86") {
+        static const struct {
+            const char *prefix;
+            Target::ISA isa;
+        } x86Extensions[] = {
+            { "llvm.x86.sse3.",      Target::SSE4 },
+            { "llvm.x86.ssse3.",     Target::SSE4 },
+            { "llvm.x86.sse41.",     Target::SSE4 },
+            { "llvm.x86.sse42.",     Target::SSE4 },
+            // PCLMULQDQ and AES-NI came with Westmere, so the first
+            // target that has them is avx (Sandy Bridge).
+            { "llvm.x86.pclmulqdq",  Target::AVX },
+            { "llvm.x86.aesni.",     Target::AVX },
+            { "llvm.x86.avx.",       Target::AVX },
+            { "llvm.x86.rdrand.",    Target::AVX11 },
+            { "llvm.x86.avx2.",      Target::AVX2 },
+            { "llvm.x86.fma.",       Target::AVX2 },
+            // BMI1 and BMI2 (bextr, pdep, pext)
+            { "llvm.x86.bmi.",       Target::AVX2 },
+            { "llvm.x86.avx512.",    Target::KNL_AVX512 },
+            // None of the targets' CPUs have the SHA extensions.
+            { "llvm.x86.sha",        Target::NUM_ISAS },
+        };
+        for (unsigned int i = 0;
+             i < sizeof(x86Extensions) / sizeof(x86Extensions[0]); ++i) {
+            const char *prefix = x86Extensions[i].prefix;
+            if (name.compare(0, strlen(prefix), prefix) == 0 &&
+                isa < x86Extensions[i].isa) {
+                Error(pos, "LLVM intrinsic \"%s\" requires an instruction "
+                      "set that the \"%s\" target doesn't provide.",
+                      name.c_str(), g->target->GetISATargetString());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+/** Returns the ispc type that corresponds to the given type of a parameter
+    or the return value of an LLVM intrinsic, or NULL if there isn't one.
+    LLVM vectors with the target's vector width map to varying types, which
+    have to be represented by exactly the given LLVM type.  Other vectors
+    map to uniform short vector types, whose LLVM vector type may have
+    more elements than the given one (see
+    VectorType::getVectorMemoryCount()); lConvertIntrinsicVector() converts
+    between the two.
+ */
+static const Type *
+lLLVMIntrinsicTypeToISPCType(llvm::Type *t) {
+    if (t == LLVMTypes::VoidType)
+        return AtomicType::Void;
+    if (t == LLVMTypes::VoidPointerType)
+        return PointerType::Void;
+
+    llvm::Type *eltType = t->isVectorTy() ? t->getVectorElementType() : t;
+    const AtomicType *atomicType = NULL;
+    if (eltType == LLVMTypes::BoolType)
+        atomicType = AtomicType::UniformBool;
+    else if (eltType == LLVMTypes::Int8Type)
+        atomicType = AtomicType::UniformInt8;
+    else if (eltType == LLVMTypes::Int16Type)
+        atomicType = AtomicType::UniformInt16;
+    else if (eltType == LLVMTypes::Int32Type)
+        atomicType = AtomicType::UniformInt32;
+    else if (eltType == LLVMTypes::Int64Type)
+        atomicType = AtomicType::UniformInt64;
+    else if (eltType == LLVMTypes::FloatType)
+        atomicType = AtomicType::UniformFloat;
+    else if (eltType == LLVMTypes::DoubleType)
+        atomicType = AtomicType::UniformDouble;
+
+    if (atomicType == NULL)
+        return NULL;
+    if (t->isVectorTy() == false)
+        return atomicType;
+
+    int count = t->getVectorNumElements();
+    if (count == g->target->getVectorWidth() &&
+        atomicType->GetAsVaryingType()->LLVMType(g->ctx) == t)
+        return atomicType->GetAsVaryingType();
+
+    return new VectorType(atomicType, count);
+}
+
+
+/** Converts a vector between the LLVM type of an intrinsic's parameter or
+    return value and the LLVM type of the corresponding ispc uniform short
+    vector, which has the same elements, possibly followed by padding.
+    The first elements are copied with a shufflevector; the padding
+    elements of the result are undefined.
+ */
+static llvm::Value *
+lConvertIntrinsicVector(llvm::Value *v, llvm::Type *destType,
+                        llvm::BasicBlock *bblock) {
+    if (v->getType() == destType)
+        return v;
+
+    int srcCount = v->getType()->getVectorNumElements();
+    int destCount = destType->getVectorNumElements();
+    llvm::SmallVector<llvm::Constant *, 16> indices;
+    for (int i = 0; i < destCount; ++i)
+        indices.push_back(i < srcCount ? LLVMInt32(i) :
+                          llvm::UndefValue::get(LLVMTypes::Int32Type));
+    return new llvm::ShuffleVectorInst(v, llvm::UndefValue::get(v->getType()),
+                                       llvm::ConstantVector::get(indices),
+                                       "intrinsic_shuffle", bblock);
+}
+
+
+Symbol *
+Module::AddLLVMIntrinsicDecl(const std::string &name, SourcePos pos) {
+    // Each intrinsic is only looked up once; later calls find the symbol
+    // that we added to the symbol table the first time.
+    std::vector<Symbol *> funcs;
+    symbolTable->LookupFunction(name.c_str(), &funcs);
+    if (funcs.size() > 0)
+        return funcs[0];
+
+    // Only intrinsics that aren't overloaded are supported, since there's
+    // no way to give the types to overload them on from ispc.  (Their
+    // names have a type suffix, so they never match exactly.)
+    llvm::Intrinsic::ID id = llvm::Intrinsic::not_intrinsic;
+    bool isOverloaded = false;
+    for (unsigned int i = 1; i < llvm::Intrinsic::num_intrinsics; ++i) {
+        llvm::Intrinsic::ID iid = (llvm::Intrinsic::ID)i;
+        if (llvm::Intrinsic::isOverloaded(iid)) {
+            std::string baseName = llvm::Intrinsic::getName(iid);
+            if (name.compare(0, baseName.size() + 1, baseName + ".") == 0)
+                isOverloaded = true;
+        }
+        else if (llvm::Intrinsic::getName(iid) == name) {
+            id = iid;
+            break;
+        }
+    }
+
+    if (id == llvm::Intrinsic::not_intrinsic) {
+        if (isOverloaded)
+            Error(pos, "Overloaded LLVM intrinsic \"%s\" can't be called "
+                  "from ispc code.", name.c_str());
+        else
+            Error(pos, "Unknown LLVM intrinsic \"%s\".", name.c_str());
+        return NULL;
+    }
+
+    if (lCheckIntrinsicTarget(name, pos) == false)
+        return NULL;
+
+    llvm::Function *func = llvm::Intrinsic::getDeclaration(module, id);
+    llvm::FunctionType *ftype = func->getFunctionType();
+
+    const Type *returnType = lLLVMIntrinsicTypeToISPCType(ftype->getReturnType());
+    if (returnType == NULL) {
+        Error(pos, "Return type of LLVM intrinsic \"%s\" can't be "
+              "represented with an ispc type on the \"%s\" target.",
+              name.c_str(), g->target->GetISATargetString());
+        return NULL;
+    }
+
+    llvm::SmallVector<const Type *, 8> argTypes;
+    for (unsigned int i = 0; i < ftype->getNumParams(); ++i) {
+        const Type *argType = lLLVMIntrinsicTypeToISPCType(ftype->getParamType(i));
+        if (argType == NULL) {
+            Error(pos, "Type of parameter %d of LLVM intrinsic \"%s\" can't "
+                  "be represented with an ispc type on the \"%s\" target.",
+                  i + 1, name.c_str(), g->target->GetISATargetString());
+            return NULL;
+        }
+        argTypes.push_back(argType);
+    }
+
+    FunctionType *funcType = new FunctionType(returnType, argTypes, pos);
+    Debug(pos, "Created symbol for LLVM intrinsic \"%s\" [%s]", name.c_str(),
+          funcType->GetString().c_str());
+
+    // If some of the uniform short vector types are padded, the ispc code
+    // calls an inline wrapper function with the ispc types, which converts
+    // the values for the intrinsic.
+    llvm::Type *llvmReturnType = returnType->LLVMType(g->ctx);
+    std::vector<llvm::Type *> llvmArgTypes;
+    bool needsWrapper = (llvmReturnType != ftype->getReturnType());
+    for (unsigned int i = 0; i < argTypes.size(); ++i) {
+        llvmArgTypes.push_back(argTypes[i]->LLVMType(g->ctx));
+        if (llvmArgTypes[i] != ftype->getParamType(i))
+            needsWrapper = true;
+    }
+
+    if (needsWrapper) {
+        llvm::FunctionType *wrapperType =
+            llvm::FunctionType::get(llvmReturnType, llvmArgTypes, false);
+        llvm::Function *wrapper =
+            llvm::Function::Create(wrapperType, llvm::GlobalValue::InternalLinkage,
+                                   "__" + name, module);
+        wrapper->setDoesNotThrow();
+#ifdef LLVM_3_2
+        wrapper->addFnAttr(llvm::Attributes::AlwaysInline);
+#else // LLVM 3.3+
+        wrapper->addFnAttr(llvm::Attribute::AlwaysInline);
+#endif
+
+        llvm::BasicBlock *bblock =
+            llvm::BasicBlock::Create(*g->ctx, "entry", wrapper, 0);
+        std::vector<llvm::Value *> args;
+        llvm::Function::arg_iterator argIter = wrapper->arg_begin();
+        for (unsigned int i = 0; i < ftype->getNumParams(); ++i, ++argIter)
+            args.push_back(lConvertIntrinsicVector(&*argIter,
+                                                   ftype->getParamType(i),
+                                                   bblock));
+        llvm::Value *result = llvm::CallInst::Create(func, args, "", bblock);
+        if (llvmReturnType == LLVMTypes::VoidType)
+            llvm::ReturnInst::Create(*g->ctx, bblock);
+        else
+            llvm::ReturnInst::Create(*g->ctx,
+                                     lConvertIntrinsicVector(result, llvmReturnType,
+                                                             bblock),
+                                     bblock);
+        func = wrapper;
+    }
+
+    Symbol *sym = new Symbol(name, pos, funcType);
+    sym->function = func;
+    symbolTable->AddFunction(sym);
+    return sym;
+}
+
+
 void
 Module::AddExportedTypes(const std::vector<std::pair<const Type *,
                                                      SourcePos> > &types) {
@@ -1701,8 +1973,6 @@ lEmitVectorTypedefs(const std::vector<const VectorType *> &types, FILE *file) {
     fprintf(file, "// Vector types with external visibility from ispc code\n");
     fprintf(file, "///////////////////////////////////////////////////////////////////////////\n\n");
 
-    int align = g->target->getNativeVectorWidth() * 4;
-
     for (unsigned int i = 0; i < types.size(); ++i) {
         std::string baseDecl;
         const VectorType *vt = types[i]->GetAsNonConstType();
@@ -1713,6 +1983,11 @@ lEmitVectorTypedefs(const std::vector<const VectorType *> &types, FILE *file) {
             continue;
 
         int size = vt->GetElementCount();
+        // Match the alignment that LLVM gives the padded vector type, so
+        // that sizeof() and array strides agree between the application
+        // and the ispc code.
+        int align = (int)g->target->getDataLayout()->getABITypeAlignment(
+            vt->LLVMType(g->ctx));
 
         baseDecl = vt->GetBaseType()->GetCDeclaration("");
         fprintf(file, "#ifndef __ISPC_VECTOR_%s%d__\n",baseDecl.c_str(), size);
@@ -2505,6 +2780,18 @@ Module::execPreprocessor(const char *infilename, llvm::raw_string_ostream *ostre
     }
     opts.addMacroDef(targetMacro);
 
+    char widthMacro[64];
+    sprintf(widthMacro, "ISPC_TARGET_WIDTH=%d", g->target->getVectorWidth());
+    opts.addMacroDef(widthMacro);
+
+    char nativeWidthMacro[64];
+    sprintf(nativeWidthMacro, "ISPC_NATIVE_VECTOR_WIDTH=%d",
+            g->target->getNativeVectorWidth());
+    opts.addMacroDef(nativeWidthMacro);
+    if (g->opt.portableShortVectorLayout &&
+        g->target->getISA() != Target::GENERIC)
+        opts.addMacroDef("ISPC_PORTABLE_SHORT_VECTORS");
+
     if (g->target->is32Bit())
         opts.addMacroDef("ISPC_POINTER_SIZE=32");
     else
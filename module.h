@@ -88,6 +88,13 @@ public:
     void AddFunctionDefinition(const std::string &name,
                                const FunctionType *ftype, Stmt *code);
 
+    /** Returns the function symbol for a call to the LLVM intrinsic with
+        the given name (e.g. "llvm.x86.sse2.pause"), creating it the first
+        time that the intrinsic is used.  Issues an error and returns NULL
+        if the intrinsic doesn't exist, isn't available on the current
+        target, or if its signature can't be expressed with ispc types. */
+    Symbol *AddLLVMIntrinsicDecl(const std::string &name, SourcePos pos);
+
     /** Adds the given type to the set of types that have their definitions
         included in automatically generated header files. */
     void AddExportedTypes(const std::vector<std::pair<const Type *,
@@ -46,6 +46,7 @@
 #include <stdio.h>
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include <llvm/Pass.h>
 #if defined(LLVM_3_2)
@@ -133,6 +134,7 @@
 static llvm::Pass *CreateIntrinsicsOptPass();
 static llvm::Pass *CreateInstructionSimplifyPass();
 static llvm::Pass *CreatePeepholePass();
+static llvm::Pass *CreateMaskTestCSEPass();
 
 static llvm::Pass *CreateImproveMemoryOpsPass();
 static llvm::Pass *CreateGatherCoalescePass();
@@ -626,6 +628,12 @@ Optimize(llvm::Module *module, int optLevel) {
         if (!g->opt.disableMaskAllOnOptimizations) {
             optPM.add(CreateIntrinsicsOptPass(), 215);
             optPM.add(CreateInstructionSimplifyPass());
+            // On NVPTX, the mask is tested with __movmsk_ptx(), which
+            // this pass doesn't look for.
+#ifdef ISPC_NVPTX_ENABLED
+            if (g->target->getISA() != Target::NVPTX)
+#endif /* ISPC_NVPTX_ENABLED */
+              optPM.add(CreateMaskTestCSEPass());
         }
         optPM.add(llvm::createDeadInstEliminationPass(), 220);
 
@@ -1367,6 +1375,356 @@ CreateInstructionSimplifyPass() {
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+// MaskTestCSEPass
+
+/** Nested varying control flow tests the execution mask at each level:
+    IfStmt::emitMaskMixed() and friends branch on __any(), __all() or
+    __none() of the current mask, and foreach_active and foreach_unique
+    use __movmsk() of it.  The masks at the inner levels are derived from
+    the ones at the outer levels by and-ing in the inner tests, so many of
+    these tests are either repeated or have outcomes that are implied by
+    the branches that led to them.  Since the tests are calls to builtins
+    until they are inlined, LLVM's own passes don't see any of this.
+
+    This pass walks up the chain of single predecessors of each basic
+    block; each of these blocks dominates the block.  It collects the
+    mask tests computed in those blocks as well as the outcomes of the
+    mask tests that the branches taken along the chain imply, and then
+    replaces the mask tests in the block with an earlier result, a value
+    derived from an earlier __movmsk() of the same mask, or a constant.
+ */
+class MaskTestCSEPass : public llvm::FunctionPass {
+public:
+    static char ID;
+    MaskTestCSEPass() : FunctionPass(ID) { }
+
+    const char *getPassName() const { return "Mask Test CSE"; }
+    bool runOnFunction(llvm::Function &F);
+
+private:
+    enum TestKind { ANY, ALL, NONE, MOVMSK };
+
+    /** A mask test that has already been computed. */
+    struct MaskTest {
+        MaskTest(TestKind k, llvm::Value *m, llvm::Value *v)
+            : kind(k), mask(m), value(v) { }
+        TestKind kind;
+        llvm::Value *mask;
+        llvm::Value *value;
+    };
+
+    /** What a branch on a mask test tells us about the lanes of a mask. */
+    enum FactKind { FACT_SOME_ON, FACT_NONE_ON, FACT_ALL_ON, FACT_NOT_ALL_ON };
+    struct MaskFact {
+        MaskFact(FactKind k, llvm::Value *m) : kind(k), mask(m) { }
+        FactKind kind;
+        llvm::Value *mask;
+    };
+
+    bool getMaskTest(llvm::Instruction *inst, TestKind *kind,
+                     llvm::Value **mask) const;
+    void addBranchFact(llvm::BasicBlock *pred, llvm::BasicBlock *succ,
+                       std::vector<MaskFact> *facts) const;
+    llvm::Value *lookupTest(llvm::CallInst *callInst, TestKind kind,
+                            llvm::Value *mask,
+                            const std::vector<MaskTest> &tests,
+                            const std::vector<MaskFact> &facts) const;
+
+    llvm::Function *testFunctions[4];
+};
+
+char MaskTestCSEPass::ID = 0;
+
+
+/** Returns the given mask with any bitcasts that don't change the number
+    of vector elements removed. */
+static llvm::Value *
+lStripMaskCasts(llvm::Value *mask) {
+    while (llvm::BitCastInst *bc = llvm::dyn_cast<llvm::BitCastInst>(mask)) {
+        llvm::VectorType *srcType =
+            llvm::dyn_cast<llvm::VectorType>(bc->getSrcTy());
+        llvm::VectorType *destType =
+            llvm::dyn_cast<llvm::VectorType>(bc->getDestTy());
+        if (srcType == NULL || destType == NULL ||
+            srcType->getNumElements() != destType->getNumElements())
+            break;
+        mask = bc->getOperand(0);
+    }
+    return mask;
+}
+
+
+/** Collects the operands of the tree of 'and' operations that computes
+    the given mask; the mask's lanes are on where all of them are on. */
+static void
+lGetMaskConjuncts(llvm::Value *mask, std::vector<llvm::Value *> *conjuncts,
+                  int depth = 0) {
+    mask = lStripMaskCasts(mask);
+    llvm::BinaryOperator *bop = llvm::dyn_cast<llvm::BinaryOperator>(mask);
+    if (bop != NULL && bop->getOpcode() == llvm::Instruction::And &&
+        depth < 16) {
+        lGetMaskConjuncts(bop->getOperand(0), conjuncts, depth + 1);
+        lGetMaskConjuncts(bop->getOperand(1), conjuncts, depth + 1);
+    }
+    else if (lGetMaskStatus(mask) != ALL_ON)
+        conjuncts->push_back(mask);
+}
+
+
+/** Returns true if we can determine that each lane that is on in mask
+    'a' is also on in mask 'b'. */
+static bool
+lMaskIsSubset(llvm::Value *a, llvm::Value *b, int depth = 0) {
+    a = lStripMaskCasts(a);
+    b = lStripMaskCasts(b);
+    if (a == b || lGetMaskStatus(a) == ALL_OFF || lGetMaskStatus(b) == ALL_ON)
+        return true;
+    if (depth > 4)
+        return false;
+
+    // a = x & y & ... is a subset of b = x & ... if all of the terms of b
+    // are also terms of a.
+    std::vector<llvm::Value *> aTerms, bTerms;
+    lGetMaskConjuncts(a, &aTerms);
+    lGetMaskConjuncts(b, &bTerms);
+    bool allFound = true;
+    for (unsigned int i = 0; i < bTerms.size() && allFound; ++i)
+        allFound = (std::find(aTerms.begin(), aTerms.end(), bTerms[i]) !=
+                    aTerms.end());
+    if (allFound)
+        return true;
+
+    llvm::BinaryOperator *aOp = llvm::dyn_cast<llvm::BinaryOperator>(a);
+    if (aOp != NULL && aOp->getOpcode() == llvm::Instruction::Or)
+        return (lMaskIsSubset(aOp->getOperand(0), b, depth + 1) &&
+                lMaskIsSubset(aOp->getOperand(1), b, depth + 1));
+    llvm::BinaryOperator *bOp = llvm::dyn_cast<llvm::BinaryOperator>(b);
+    if (bOp != NULL && bOp->getOpcode() == llvm::Instruction::Or)
+        return (lMaskIsSubset(a, bOp->getOperand(0), depth + 1) ||
+                lMaskIsSubset(a, bOp->getOperand(1), depth + 1));
+    return false;
+}
+
+
+/** Returns true if the given instruction is a call to one of the mask
+    test builtins, returning the kind of test and the mask tested. */
+bool
+MaskTestCSEPass::getMaskTest(llvm::Instruction *inst, TestKind *kind,
+                             llvm::Value **mask) const {
+    llvm::CallInst *callInst = llvm::dyn_cast<llvm::CallInst>(inst);
+    if (callInst == NULL || callInst->getNumArgOperands() != 1)
+        return false;
+
+    llvm::Function *func = callInst->getCalledFunction();
+    for (int i = 0; i < 4; ++i) {
+        if (func != NULL && func == testFunctions[i]) {
+            *kind = (TestKind)i;
+            *mask = callInst->getArgOperand(0);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/** If 'pred' ends with a conditional branch on a mask test and 'succ' is
+    only reached along one of its edges, records what taking that edge
+    tells us about the tested mask. */
+void
+MaskTestCSEPass::addBranchFact(llvm::BasicBlock *pred, llvm::BasicBlock *succ,
+                               std::vector<MaskFact> *facts) const {
+    llvm::BranchInst *br = llvm::dyn_cast<llvm::BranchInst>(pred->getTerminator());
+    if (br == NULL || br->isConditional() == false ||
+        br->getSuccessor(0) == br->getSuccessor(1))
+        return;
+
+    bool outcome = (br->getSuccessor(0) == succ);
+    llvm::Value *cond = br->getCondition();
+
+    // Look through "not" operations on the test's result.
+    llvm::BinaryOperator *bop;
+    while ((bop = llvm::dyn_cast<llvm::BinaryOperator>(cond)) != NULL &&
+           bop->getOpcode() == llvm::Instruction::Xor &&
+           bop->getOperand(1) == LLVMTrue) {
+        cond = bop->getOperand(0);
+        outcome = !outcome;
+    }
+
+    llvm::Instruction *condInst = llvm::dyn_cast<llvm::Instruction>(cond);
+    TestKind kind;
+    llvm::Value *mask;
+    if (condInst == NULL || getMaskTest(condInst, &kind, &mask) == false)
+        return;
+
+    if (kind == ANY)
+        facts->push_back(MaskFact(outcome ? FACT_SOME_ON : FACT_NONE_ON, mask));
+    else if (kind == NONE)
+        facts->push_back(MaskFact(outcome ? FACT_NONE_ON : FACT_SOME_ON, mask));
+    else if (kind == ALL)
+        facts->push_back(MaskFact(outcome ? FACT_ALL_ON : FACT_NOT_ALL_ON, mask));
+}
+
+
+/** Returns a value that can be used in place of the given mask test, or
+    NULL if there isn't one. */
+llvm::Value *
+MaskTestCSEPass::lookupTest(llvm::CallInst *callInst, TestKind kind,
+                            llvm::Value *mask,
+                            const std::vector<MaskTest> &tests,
+                            const std::vector<MaskFact> &facts) const {
+    int width = g->target->getVectorWidth();
+    uint64_t allOnBits = (width == 64) ? ~0ull : ((1ull << width) - 1);
+
+    // First see if the outcome is implied by a dominating branch.
+    for (unsigned int i = 0; i < facts.size(); ++i) {
+        const MaskFact &fact = facts[i];
+        switch (fact.kind) {
+        case FACT_SOME_ON:
+            // Some lane of a subset of the mask is on
+            if (lMaskIsSubset(fact.mask, mask)) {
+                if (kind == ANY)
+                    return LLVMTrue;
+                if (kind == NONE)
+                    return LLVMFalse;
+            }
+            break;
+        case FACT_NONE_ON:
+            // No lane of a superset of the mask is on
+            if (lMaskIsSubset(mask, fact.mask)) {
+                if (kind == ANY || kind == ALL)
+                    return LLVMFalse;
+                if (kind == NONE)
+                    return LLVMTrue;
+                return LLVMInt64(0);
+            }
+            break;
+        case FACT_ALL_ON:
+            // All lanes of a subset of the mask are on
+            if (lMaskIsSubset(fact.mask, mask)) {
+                if (kind == ANY || kind == ALL)
+                    return LLVMTrue;
+                if (kind == NONE)
+                    return LLVMFalse;
+                return LLVMInt64(allOnBits);
+            }
+            break;
+        case FACT_NOT_ALL_ON:
+            // Not all lanes of a superset of the mask are on
+            if (kind == ALL && lMaskIsSubset(mask, fact.mask))
+                return LLVMFalse;
+            break;
+        }
+    }
+
+    // Otherwise, look for a dominating test of the same mask.
+    for (unsigned int i = 0; i < tests.size(); ++i) {
+        const MaskTest &test = tests[i];
+        if (lMaskIsSubset(mask, test.mask) == false ||
+            lMaskIsSubset(test.mask, mask) == false)
+            continue;
+
+        if (test.kind == kind)
+            return test.value;
+        if (test.kind == MOVMSK) {
+            // Derive the test from the bits of the mask
+            if (kind == ANY)
+                return new llvm::ICmpInst(callInst, llvm::CmpInst::ICMP_NE,
+                                          test.value, LLVMInt64(0), "any");
+            if (kind == NONE)
+                return new llvm::ICmpInst(callInst, llvm::CmpInst::ICMP_EQ,
+                                          test.value, LLVMInt64(0), "none");
+            if (kind == ALL)
+                return new llvm::ICmpInst(callInst, llvm::CmpInst::ICMP_EQ,
+                                          test.value, LLVMInt64(allOnBits),
+                                          "all");
+        }
+    }
+    return NULL;
+}
+
+
+bool
+MaskTestCSEPass::runOnFunction(llvm::Function &F) {
+    llvm::Module *module = F.getParent();
+    testFunctions[ANY] = module->getFunction("__any");
+    testFunctions[ALL] = module->getFunction("__all");
+    testFunctions[NONE] = module->getFunction("__none");
+    testFunctions[MOVMSK] = module->getFunction("__movmsk");
+
+    bool modifiedAny = false;
+    for (llvm::Function::iterator bbIter = F.begin(); bbIter != F.end();
+         ++bbIter) {
+        llvm::BasicBlock *bb = &*bbIter;
+
+        // Gather the tests and branch outcomes from the chain of blocks
+        // that dominate this one; the depth limit keeps this linear in
+        // practice.
+        std::vector<MaskTest> tests;
+        std::vector<MaskFact> facts;
+        llvm::BasicBlock *succ = bb;
+        for (int depth = 0; depth < 32; ++depth) {
+            llvm::BasicBlock *pred = succ->getSinglePredecessor();
+            if (pred == NULL || pred == bb)
+                break;
+            addBranchFact(pred, succ, &facts);
+            for (llvm::BasicBlock::iterator iter = pred->begin();
+                 iter != pred->end(); ++iter) {
+                TestKind kind;
+                llvm::Value *mask;
+                if (getMaskTest(&*iter, &kind, &mask))
+                    tests.push_back(MaskTest(kind, mask, &*iter));
+            }
+            succ = pred;
+        }
+
+        if (tests.empty() && facts.empty()) {
+            // Only tests in this block itself can help; skip the block
+            // quickly if it doesn't have more than one.
+            int count = 0;
+            for (llvm::BasicBlock::iterator iter = bb->begin();
+                 iter != bb->end(); ++iter) {
+                TestKind kind;
+                llvm::Value *mask;
+                count += getMaskTest(&*iter, &kind, &mask) ? 1 : 0;
+            }
+            if (count < 2)
+                continue;
+        }
+
+        std::vector<llvm::CallInst *> deadCalls;
+        for (llvm::BasicBlock::iterator iter = bb->begin(); iter != bb->end();
+             ++iter) {
+            TestKind kind;
+            llvm::Value *mask;
+            if (getMaskTest(&*iter, &kind, &mask) == false)
+                continue;
+
+            llvm::CallInst *callInst = llvm::cast<llvm::CallInst>(&*iter);
+            llvm::Value *value = lookupTest(callInst, kind, mask, tests, facts);
+            if (value != NULL) {
+                callInst->replaceAllUsesWith(value);
+                deadCalls.push_back(callInst);
+            }
+            else
+                tests.push_back(MaskTest(kind, mask, callInst));
+        }
+
+        for (unsigned int i = 0; i < deadCalls.size(); ++i)
+            deadCalls[i]->eraseFromParent();
+        modifiedAny |= (deadCalls.size() > 0);
+    }
+
+    return modifiedAny;
+}
+
+
+static llvm::Pass *
+CreateMaskTestCSEPass() {
+    return new MaskTestCSEPass;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 // ImproveMemoryOpsPass
 
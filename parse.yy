@@ -188,6 +188,7 @@ struct ForeachDimension {
 %token TOKEN_INT64DOTDOTDOT_CONSTANT TOKEN_UINT64DOTDOTDOT_CONSTANT
 %token TOKEN_FLOAT_CONSTANT TOKEN_DOUBLE_CONSTANT TOKEN_STRING_C_LITERAL
 %token TOKEN_IDENTIFIER TOKEN_STRING_LITERAL TOKEN_TYPE_NAME TOKEN_NULL
+%token TOKEN_INTRINSIC_NAME
 %token TOKEN_PTR_OP TOKEN_INC_OP TOKEN_DEC_OP TOKEN_LEFT_OP TOKEN_RIGHT_OP
 %token TOKEN_LE_OP TOKEN_GE_OP TOKEN_EQ_OP TOKEN_NE_OP
 %token TOKEN_AND_OP TOKEN_OR_OP TOKEN_MUL_ASSIGN TOKEN_DIV_ASSIGN TOKEN_MOD_ASSIGN
@@ -294,6 +295,15 @@ primary_expression
             Error(@1, "Undeclared symbol \"%s\".%s", name, alts.c_str());
         }
     }
+    | TOKEN_INTRINSIC_NAME {
+        Symbol *s = m->AddLLVMIntrinsicDecl(*yylval.stringVal, @1);
+        $$ = NULL;
+        if (s != NULL) {
+            std::vector<Symbol *> funs;
+            funs.push_back(s);
+            $$ = new FunctionSymbolExpr(s->name.c_str(), funs, @1);
+        }
+    }
     | TOKEN_INT8_CONSTANT {
         $$ = new ConstExpr(AtomicType::UniformInt8->GetAsConstType(),
                            (int8_t)yylval.intVal, @1);
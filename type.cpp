@@ -1832,8 +1832,8 @@ llvm::DIType *VectorType::GetDIType(llvm::DIScope *scope) const {
 #endif
 
     // vectors of varying types are already naturally aligned to the
-    // machine's vector width, but arrays of uniform types need to be
-    // explicitly aligned to the machines natural vector alignment.
+    // machine's vector width, but uniform short vectors need to be given
+    // the alignment of the (padded) LLVM vector type that holds them.
 #if defined (LLVM_3_3)|| defined (LLVM_3_4) || defined (LLVM_3_5) || defined (LLVM_3_6)
     llvm::DIArray subArray = m->diBuilder->getOrCreateArray(sub);
     uint64_t sizeBits = eltType.getSizeInBits() * numElements;
@@ -1845,7 +1845,7 @@ llvm::DIType *VectorType::GetDIType(llvm::DIScope *scope) const {
 #endif
 
     if (IsUniformType())
-        align = 4 * g->target->getNativeVectorWidth();
+        align = 8 * g->target->getDataLayout()->getABITypeAlignment(LLVMType(g->ctx));
 
     if (IsUniformType() || IsVaryingType())
         return m->diBuilder->createVectorType(sizeBits, align, eltType, subArray);
@@ -1869,6 +1869,21 @@ VectorType::getVectorMemoryCount() const {
     if (base->IsVaryingType())
         return numElements;
     else if (base->IsUniformType()) {
+        if (g->opt.portableShortVectorLayout &&
+            g->target->getISA() != Target::GENERIC) {
+            // With --short-vector-layout=portable, round up the element
+            // count to the next power of two, so that e.g. a float<3> is
+            // held in a <4 x float> on every target and the memory layout
+            // is the same across all of the targets of a multi-target
+            // build.  (The C++ backend only knows how to emit vectors of
+            // the target's width, so the generic targets always use the
+            // native layout.)
+            int count = 1;
+            while (count < numElements)
+                count *= 2;
+            return count;
+        }
+
         int nativeWidth = g->target->getNativeVectorWidth();
         if (Type::Equal(base->GetAsUniformType(), AtomicType::UniformInt64) ||
             Type::Equal(base->GetAsUniformType(), AtomicType::UniformUInt64) ||